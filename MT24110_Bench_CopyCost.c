@@ -0,0 +1,331 @@
+/*
+ * MT24110_Bench_CopyCost.c
+ * Microbenchmark: where the cycles of one message go
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * For the message sizes used by MT24110_run_experiments.sh this times,
+ * on one thread and without any peer to wait for:
+ *
+ *   memcpy       - one user-space copy of the message
+ *   serialize    - mt24110_serialize_message of a prepared message
+ *   deserialize  - mt24110_deserialize_message + destroy
+ *   pipe         - write() + read() through a pipe: two copies, two syscalls
+ *                  (messages larger than the pipe can grow to, see
+ *                  /proc/sys/fs/pipe-max-size, go through in pipe-sized
+ *                  chunks, two syscalls per chunk)
+ *   send/sendmsg/zerocopy
+ *                - the A1/A2/A3 send path plus recv() on the other end of a
+ *                  loopback TCP connection: copies, syscalls and TCP/IP
+ *                  (messages over half of tcp_wmem's maximum would not
+ *                  fit in the socket buffers before the read starts and
+ *                  go through in chunks of that size)
+ *
+ * Differences between rows attribute the cost: pipe - 2 x memcpy is the
+ * syscall overhead, socket - pipe is the network stack. Reported per
+ * message as ns/byte, cycles/byte and cache misses per KB (kernel time
+ * included when perf_event_paranoid allows it, marked "u" otherwise).
+ *
+ * Usage: ./MT24110_Bench_CopyCost [messages_per_case [size ...]]
+ */
+
+#define _GNU_SOURCE
+#include "MT24110_Common.h"
+#include "MT24110_Transport.h"
+#include "MT24110_PerfCounter.h"
+#include <fcntl.h>
+
+#define MT24110_BENCH_DEFAULT_MESSAGES 50000
+
+/* Socket chunk when tcp_wmem cannot be read (its usual maximum / 2) */
+#define MT24110_BENCH_SOCKET_CHUNK (2 * 1024 * 1024)
+
+/* Default: same sizes as MESSAGE_SIZES in MT24110_run_experiments.sh */
+static const int default_sizes[] = { 512, 1024, 4096, 8192 };
+#define MT24110_BENCH_NUM_DEFAULT_SIZES (int)(sizeof(default_sizes) / sizeof(default_sizes[0]))
+
+/* State shared by every case */
+typedef struct {
+    int size;
+    char *src;
+    char *dst;
+    MT24110_Message *msg;
+    int pipe_fds[2];
+    int pipe_chunk;             /* bytes per write()/read(), <= pipe capacity */
+    int tx_fd;
+    int rx_fd;
+    int socket_chunk;           /* bytes per send + read, fits the socket buffers */
+    MT24110_SendPath path;
+    MT24110_PathCounters paths;
+    int error;
+} MT24110_CopyCase;
+
+typedef struct {
+    const char *name;
+    void (*op)(MT24110_CopyCase *c);
+    MT24110_SendPath path;      /* socket cases only */
+} MT24110_CopyOp;
+
+/* Keep the compiler from discarding writes nobody reads */
+static void mt24110_clobber(void *p) {
+    __asm__ volatile("" : : "r"(p) : "memory");
+}
+
+static int mt24110_read_exact(int fd, char *buffer, int len) {
+    int got = 0;
+    while (got < len) {
+        int r = read(fd, buffer + got, len - got);
+        if (r <= 0) {
+            if (r < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        got += r;
+    }
+    return 0;
+}
+
+static void mt24110_op_memcpy(MT24110_CopyCase *c) {
+    memcpy(c->dst, c->src, c->size);
+    mt24110_clobber(c->dst);
+}
+
+static void mt24110_op_serialize(MT24110_CopyCase *c) {
+    mt24110_serialize_message(c->msg, c->dst, c->size);
+    mt24110_clobber(c->dst);
+}
+
+static void mt24110_op_deserialize(MT24110_CopyCase *c) {
+    MT24110_Message *msg = mt24110_deserialize_message(c->src, c->size);
+    mt24110_destroy_message(msg);
+}
+
+static void mt24110_op_pipe(MT24110_CopyCase *c) {
+    for (int off = 0; off < c->size; off += c->pipe_chunk) {
+        int len = (c->size - off < c->pipe_chunk) ? c->size - off : c->pipe_chunk;
+        if (write(c->pipe_fds[1], c->src + off, len) != len ||
+            mt24110_read_exact(c->pipe_fds[0], c->dst + off, len) < 0) {
+            c->error = errno ? errno : EIO;
+            return;
+        }
+    }
+}
+
+static void mt24110_op_socket(MT24110_CopyCase *c) {
+    for (int off = 0; off < c->size; off += c->socket_chunk) {
+        int len = (c->size - off < c->socket_chunk) ? c->size - off : c->socket_chunk;
+        int sent = mt24110_transport_send(c->tx_fd, c->src + off, len, c->path, &c->paths);
+        if (sent != len || mt24110_read_exact(c->rx_fd, c->dst + off, len) < 0) {
+            c->error = errno ? errno : EIO;
+            return;
+        }
+    }
+    if (c->path == MT24110_PATH_ZEROCOPY) {
+        mt24110_reap_zerocopy(c->tx_fd, &c->paths, 0);
+    }
+}
+
+/* Read the field-th integer of a /proc/sys file, -1 if unavailable */
+static long mt24110_read_sysctl(const char *path, int field) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return -1;
+
+    long value = -1;
+    for (int i = 0; i <= field; i++) {
+        if (fscanf(f, "%ld", &value) != 1) {
+            value = -1;
+            break;
+        }
+    }
+    fclose(f);
+    return value;
+}
+
+/* Connected loopback TCP pair, tx with SO_ZEROCOPY so every path works */
+static int mt24110_tcp_pair(int *tx_fd, int *rx_fd) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+
+    if (listen_fd < 0 ||
+        bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, 1) < 0 ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &len) < 0) {
+        perror("loopback listener failed");
+        return -1;
+    }
+
+    int one = 1;
+    *tx_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (setsockopt(*tx_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+        perror("SO_ZEROCOPY");
+    }
+    setsockopt(*tx_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(*tx_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("connect failed");
+        return -1;
+    }
+    *rx_fd = accept(listen_fd, NULL, NULL);
+    close(listen_fd);
+    return *rx_fd < 0 ? -1 : 0;
+}
+
+/*
+ * Open a counter counting kernel time too if allowed, user time otherwise.
+ * *user_only reports which one was opened.
+ */
+static int mt24110_open_counter(uint64_t config, int *user_only) {
+    int fd = mt24110_perf_open(PERF_TYPE_HARDWARE, config, 0);
+    *user_only = 0;
+    if (fd < 0) {
+        fd = mt24110_perf_open(PERF_TYPE_HARDWARE, config, 1);
+        *user_only = 1;
+    }
+    return fd;
+}
+
+static void mt24110_print_metric(long long count, double scale, int user_only) {
+    if (count < 0) {
+        printf(" %12s", "n/a");
+    } else {
+        printf(" %11.3f%s", count * scale, user_only ? "u" : " ");
+    }
+}
+
+static void mt24110_run_case(const MT24110_CopyOp *op, MT24110_CopyCase *c, long messages) {
+    /* Warm caches, the socket and the allocator */
+    for (long i = 0; i < messages / 10 + 1; i++) {
+        op->op(c);
+    }
+
+    int cycles_user, misses_user;
+    int cycles_fd = mt24110_open_counter(PERF_COUNT_HW_CPU_CYCLES, &cycles_user);
+    int misses_fd = mt24110_open_counter(PERF_COUNT_HW_CACHE_MISSES, &misses_user);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    mt24110_perf_start(cycles_fd);
+    mt24110_perf_start(misses_fd);
+
+    for (long i = 0; i < messages && c->error == 0; i++) {
+        op->op(c);
+    }
+
+    long long cycles = mt24110_perf_stop(cycles_fd);
+    long long misses = mt24110_perf_stop(misses_fd);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    mt24110_perf_close(cycles_fd);
+    mt24110_perf_close(misses_fd);
+
+    if (c->error != 0) {
+        printf("%-12s %6d  %s\n", op->name, c->size, strerror(c->error));
+        c->error = 0;
+        return;
+    }
+
+    double bytes = (double)messages * c->size;
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%-12s %6d %12.3f %12.0f", op->name, c->size, ns / bytes, ns / messages);
+    mt24110_print_metric(cycles, 1.0 / bytes, cycles_user);
+    mt24110_print_metric(misses, 1024.0 / bytes, misses_user);
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    long messages = MT24110_BENCH_DEFAULT_MESSAGES;
+    if (argc > 1) {
+        messages = atol(argv[1]);
+    }
+
+    const int *sizes = default_sizes;
+    int num_sizes = MT24110_BENCH_NUM_DEFAULT_SIZES;
+    int arg_sizes[argc > 2 ? argc - 2 : 1];
+    if (argc > 2) {
+        num_sizes = argc - 2;
+        for (int i = 0; i < num_sizes; i++) {
+            arg_sizes[i] = atoi(argv[i + 2]);
+            if (arg_sizes[i] <= 0) messages = 0;
+        }
+        sizes = arg_sizes;
+    }
+    if (messages <= 0) {
+        fprintf(stderr, "Usage: %s [messages_per_case [size ...]]\n", argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    MT24110_CopyCase c;
+    memset(&c, 0, sizeof(c));
+    if (pipe(c.pipe_fds) < 0) {
+        perror("pipe failed");
+        return 1;
+    }
+    if (mt24110_tcp_pair(&c.tx_fd, &c.rx_fd) < 0) return 1;
+
+    long wmem_max = mt24110_read_sysctl("/proc/sys/net/ipv4/tcp_wmem", 2);
+    int socket_chunk = (wmem_max > 0) ? (int)(wmem_max / 2) : MT24110_BENCH_SOCKET_CHUNK;
+
+    static const MT24110_CopyOp ops[] = {
+        { "memcpy", mt24110_op_memcpy, MT24110_PATH_SEND },
+        { "serialize", mt24110_op_serialize, MT24110_PATH_SEND },
+        { "deserialize", mt24110_op_deserialize, MT24110_PATH_SEND },
+        { "pipe", mt24110_op_pipe, MT24110_PATH_SEND },
+        { "send", mt24110_op_socket, MT24110_PATH_SEND },
+        { "sendmsg", mt24110_op_socket, MT24110_PATH_SENDMSG },
+        { "zerocopy", mt24110_op_socket, MT24110_PATH_ZEROCOPY },
+    };
+
+    printf("=== Copy cost per message (%ld messages per case, one thread) ===\n", messages);
+    printf("%-12s %6s %12s %12s %12s %12s\n", "case", "size", "ns/byte", "ns/msg",
+           "cycles/byte", "misses/KB");
+
+    for (int s = 0; s < num_sizes; s++) {
+        c.size = sizes[s];
+        c.src = malloc(c.size);
+        c.dst = malloc(c.size);
+        MT24110_CHECK_NULL(c.src, "malloc src");
+        MT24110_CHECK_NULL(c.dst, "malloc dst");
+
+        /*
+         * The pipe and socket cases write before reading, so each write
+         * must fit. Grow the pipe up to pipe-max-size and chunk the rest.
+         */
+        c.pipe_chunk = fcntl(c.pipe_fds[1], F_GETPIPE_SZ);
+        if (c.pipe_chunk < c.size) {
+            long pipe_max = mt24110_read_sysctl("/proc/sys/fs/pipe-max-size", 0);
+            int want = (pipe_max > 0 && pipe_max < c.size) ? (int)pipe_max : c.size;
+            if (fcntl(c.pipe_fds[1], F_SETPIPE_SZ, want) >= 0) {
+                c.pipe_chunk = fcntl(c.pipe_fds[1], F_GETPIPE_SZ);
+            }
+        }
+        if (c.pipe_chunk > c.size) c.pipe_chunk = c.size;
+        c.socket_chunk = (socket_chunk < c.size) ? socket_chunk : c.size;
+        if (c.pipe_chunk < c.size || c.socket_chunk < c.size) {
+            printf("(chunked: pipe %d bytes, socket %d bytes per write)\n",
+                   c.pipe_chunk, c.socket_chunk);
+        }
+
+        /* src holds a serialized message so deserialize sees real input */
+        c.msg = mt24110_create_message(c.size);
+        mt24110_serialize_message(c.msg, c.src, c.size);
+
+        for (int o = 0; o < (int)(sizeof(ops) / sizeof(ops[0])); o++) {
+            c.path = ops[o].path;
+            mt24110_run_case(&ops[o], &c, messages);
+        }
+        printf("\n");
+
+        mt24110_destroy_message(c.msg);
+        free(c.src);
+        free(c.dst);
+    }
+
+    close(c.pipe_fds[0]);
+    close(c.pipe_fds[1]);
+    close(c.tx_fd);
+    close(c.rx_fd);
+    return 0;
+}
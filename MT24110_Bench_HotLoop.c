@@ -0,0 +1,297 @@
+/*
+ * MT24110_Bench_HotLoop.c
+ * Microbenchmark: legacy vs generic vs specialized send/recv loop
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * Runs a fixed number of round trips against an in-process loopback
+ * echo thread for every copy path and specialized size, and reports
+ * ns per message and user-space instructions per message.
+ *
+ *   legacy      - the client loop as it was: msghdr rebuilt for every
+ *                 send and recv, size and path read at run time
+ *   generic     - MT24110_HotLoop body, size and path read at run time
+ *   specialized - MT24110_HotLoop body compiled for this size and path
+ *
+ * Usage: ./MT24110_Bench_HotLoop [messages_per_run]
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_HotLoop.h"
+#include "MT24110_PerfCounter.h"
+
+#define MT24110_BENCH_DEFAULT_MESSAGES 20000
+#define MT24110_BENCH_MAX_SIZE 65536
+
+static const int bench_sizes[] = { 64, 1024, 4096, 65536 };
+#define MT24110_BENCH_NUM_SIZES (int)(sizeof(bench_sizes) / sizeof(bench_sizes[0]))
+
+/* Echo every byte back until the peer closes */
+static void *mt24110_echo_connection(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char *buffer = malloc(MT24110_BENCH_MAX_SIZE);
+    MT24110_CHECK_NULL(buffer, "malloc echo buffer");
+
+    int r;
+    while ((r = recv(fd, buffer, MT24110_BENCH_MAX_SIZE, 0)) > 0) {
+        int sent = 0;
+        while (sent < r) {
+            int s = send(fd, buffer + sent, r - sent, 0);
+            if (s <= 0) goto out;
+            sent += s;
+        }
+    }
+out:
+    free(buffer);
+    close(fd);
+    return NULL;
+}
+
+static void *mt24110_echo_listener(void *arg) {
+    int listen_fd = (int)(intptr_t)arg;
+    while (1) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, mt24110_echo_connection, (void *)(intptr_t)fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(tid);
+    }
+    return NULL;
+}
+
+/* Start the echo listener on an ephemeral loopback port */
+static int mt24110_start_echo(struct sockaddr_in *addr) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("socket failed");
+        return -1;
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr->sin_port = 0;
+
+    socklen_t len = sizeof(*addr);
+    if (bind(listen_fd, (struct sockaddr *)addr, sizeof(*addr)) < 0 ||
+        listen(listen_fd, 16) < 0 ||
+        getsockname(listen_fd, (struct sockaddr *)addr, &len) < 0) {
+        perror("echo listener setup failed");
+        close(listen_fd);
+        return -1;
+    }
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, mt24110_echo_listener, (void *)(intptr_t)listen_fd) != 0) {
+        perror("pthread_create echo failed");
+        close(listen_fd);
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+static int mt24110_bench_connect(const struct sockaddr_in *addr, MT24110_SendPath path) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket failed");
+        return -1;
+    }
+    if (path == MT24110_PATH_ZEROCOPY) {
+        int one = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+            perror("SO_ZEROCOPY");
+        }
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) < 0) {
+        perror("connect failed");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * The pre-specialization client loop, kept here as the baseline
+ */
+static void mt24110_legacy_loop(MT24110_HotLoopArgs *a) {
+    struct iovec iov[1];
+    struct msghdr msg_header;
+    int flags = (a->path == MT24110_PATH_ZEROCOPY) ? MSG_ZEROCOPY : 0;
+    long messages = 0;
+
+    while (*a->running && messages < a->max_messages) {
+        int sent;
+        if (a->path == MT24110_PATH_SEND) {
+            sent = send(a->fd, a->send_buffer, a->size, 0);
+        } else {
+            memset(&msg_header, 0, sizeof(msg_header));
+            iov[0].iov_base = a->send_buffer;
+            iov[0].iov_len = a->size;
+            msg_header.msg_iov = iov;
+            msg_header.msg_iovlen = 1;
+            sent = sendmsg(a->fd, &msg_header, flags);
+        }
+        if (sent < 0 && a->path == MT24110_PATH_ZEROCOPY && errno == ENOBUFS) {
+            mt24110_reap_zerocopy(a->fd, &a->paths, 100);
+            continue;
+        }
+        if (sent != a->size) {
+            a->error = (sent < 0) ? errno : EIO;
+            return;
+        }
+
+        memset(&msg_header, 0, sizeof(msg_header));
+        msg_header.msg_iov = iov;
+        msg_header.msg_iovlen = 1;
+
+        int received = 0;
+        while (received < sent) {
+            iov[0].iov_base = a->recv_buffer + received;
+            iov[0].iov_len = sent - received;
+            int r = (a->path == MT24110_PATH_SEND)
+                        ? recv(a->fd, a->recv_buffer + received, sent - received, 0)
+                        : recvmsg(a->fd, &msg_header, 0);
+            if (r <= 0) {
+                a->error = (r < 0) ? errno : ECONNRESET;
+                return;
+            }
+            received += r;
+        }
+        if (a->path == MT24110_PATH_ZEROCOPY) {
+            mt24110_reap_zerocopy(a->fd, &a->paths, 0);
+        }
+        a->messages++;
+        messages++;
+    }
+}
+
+/*
+ * One timed run on a fresh connection. Returns 0 on success and fills
+ * ns and instructions per message (instructions -1 if unavailable).
+ */
+static int mt24110_bench_run(const struct sockaddr_in *addr, MT24110_HotLoopFn fn,
+                             MT24110_SendPath path, int size, long messages,
+                             char *send_buffer, char *recv_buffer,
+                             double *ns_per_msg, double *insns_per_msg) {
+    int fd = mt24110_bench_connect(addr, path);
+    if (fd < 0) return -1;
+
+    volatile int running = 1;
+    MT24110_HotLoopArgs args;
+    memset(&args, 0, sizeof(args));
+    args.fd = fd;
+    args.send_buffer = send_buffer;
+    args.recv_buffer = recv_buffer;
+    args.size = size;
+    args.path = path;
+    args.running = &running;
+
+    /* Warm up the connection, caches and branch predictors */
+    args.max_messages = messages / 10 + 1;
+    fn(&args);
+    long warm = args.messages;
+    args.max_messages = messages;
+
+    int perf_fd = mt24110_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 1);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    mt24110_perf_start(perf_fd);
+
+    fn(&args);
+
+    long long insns = mt24110_perf_stop(perf_fd);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    mt24110_perf_close(perf_fd);
+    close(fd);
+
+    long done = args.messages - warm;
+    if (args.error != 0 || done <= 0) {
+        fprintf(stderr, "%s size %d: %s\n", mt24110_path_name(path), size,
+                strerror(args.error ? args.error : EIO));
+        return -1;
+    }
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    *ns_per_msg = ns / done;
+    *insns_per_msg = (insns >= 0) ? (double)insns / done : -1;
+    return 0;
+}
+
+static void mt24110_print_insns(double insns) {
+    if (insns < 0) {
+        printf(" %10s", "n/a");
+    } else {
+        printf(" %10.0f", insns);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long messages = MT24110_BENCH_DEFAULT_MESSAGES;
+    if (argc > 1) {
+        messages = atol(argv[1]);
+        if (messages <= 0) {
+            fprintf(stderr, "Usage: %s [messages_per_run]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    mt24110_shutdown_init(MT24110_DEFAULT_DRAIN_MS);
+
+    struct sockaddr_in addr;
+    if (mt24110_start_echo(&addr) < 0) return 1;
+
+    char *send_buffer = malloc(MT24110_BENCH_MAX_SIZE);
+    char *recv_buffer = malloc(MT24110_BENCH_MAX_SIZE);
+    MT24110_CHECK_NULL(send_buffer, "malloc send buffer");
+    MT24110_CHECK_NULL(recv_buffer, "malloc recv buffer");
+    memset(send_buffer, 'A', MT24110_BENCH_MAX_SIZE);
+
+    printf("=== Hot loop microbenchmark (%ld round trips per run, loopback) ===\n", messages);
+    printf("%-9s %7s | %10s %10s %10s | %10s %10s %10s\n", "path", "size",
+           "legacy ns", "generic", "special", "legacy ins", "generic", "special");
+
+    for (int p = 0; p < MT24110_PATH_COUNT; p++) {
+        MT24110_SendPath path = (MT24110_SendPath)p;
+        for (int s = 0; s < MT24110_BENCH_NUM_SIZES; s++) {
+            int size = bench_sizes[s];
+            MT24110_HotLoopFn variants[3] = {
+                mt24110_legacy_loop,
+                mt24110_hot_loop_generic,
+                mt24110_hot_loop_select(path, size),
+            };
+            double ns[3], insns[3];
+            int ok = 1;
+            for (int v = 0; v < 3 && ok; v++) {
+                ok = mt24110_bench_run(&addr, variants[v], path, size, messages,
+                                       send_buffer, recv_buffer, &ns[v], &insns[v]) == 0;
+            }
+            if (!ok) continue;
+
+            printf("%-9s %7d | %10.0f %10.0f %10.0f |", mt24110_path_name(path), size,
+                   ns[0], ns[1], ns[2]);
+            for (int v = 0; v < 3; v++) {
+                mt24110_print_insns(insns[v]);
+            }
+            printf("\n");
+        }
+    }
+
+    free(send_buffer);
+    free(recv_buffer);
+    return 0;
+}
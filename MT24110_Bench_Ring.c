@@ -0,0 +1,347 @@
+/*
+ * MT24110_Bench_Ring.c
+ * Microbenchmark: SPSC/MPSC ring throughput and latency across core pairs
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * For every producer:consumer CPU pair this pins two threads and runs
+ *
+ *   spsc           - items through the SPSC ring, spinning on full/empty
+ *   spsc-batch     - the same with push_batch/pop_batch of `batch` items
+ *   spsc-wait      - push_wait/pop_wait, sleeping on the futex
+ *   pingpong       - one item bounced through two SPSC rings: one-way
+ *                    latency is half the round trip
+ *   mpsc-N         - N producers (spread over the online CPUs) into one
+ *                    consumer on the pair's consumer CPU
+ *
+ * Same-core pairs only show the cost of the code path: the threads take
+ * turns on one CPU. Cross-core pairs add cache-line transfers, and the
+ * pair on the other half of the CPU list typically crosses an SMT or
+ * socket boundary.
+ *
+ * Usage: ./MT24110_Bench_Ring [items [batch [PRODUCER:CONSUMER ...]]]
+ */
+
+#define _GNU_SOURCE
+#include "MT24110_Common.h"
+#include "MT24110_Ring.h"
+#include <sched.h>
+
+#define MT24110_BENCH_DEFAULT_ITEMS 2000000
+#define MT24110_BENCH_DEFAULT_BATCH 32
+#define MT24110_BENCH_RING_SIZE 1024
+#define MT24110_BENCH_MAX_BATCH 1024
+#define MT24110_BENCH_MPSC_PRODUCERS 3
+
+typedef struct {
+    int producer_cpu;
+    int consumer_cpu;
+} MT24110_CpuPair;
+
+typedef struct {
+    MT24110_SpscRing *ring;
+    MT24110_SpscRing *reply;    /* pingpong only */
+    MT24110_MpscRing *mpsc;
+    long items;
+    int batch;
+    int cpu;
+    long checksum;
+} MT24110_BenchThread;
+
+static int num_cpus;
+
+static void mt24110_pin(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % num_cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* Spin, but give the CPU away now and then so same-core pairs progress */
+static void mt24110_backoff(int *fails) {
+    if (++*fails < 64) {
+        MT24110_CPU_RELAX();
+    } else {
+        sched_yield();
+        *fails = 0;
+    }
+}
+
+static double mt24110_elapsed_s(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+/* Items are 1..items cast to pointers; the consumer sums them */
+static void *mt24110_spsc_producer(void *arg) {
+    MT24110_BenchThread *t = arg;
+    mt24110_pin(t->cpu);
+    void *items[MT24110_BENCH_MAX_BATCH];
+    int fails = 0;
+
+    for (long next = 1; next <= t->items;) {
+        int n = (int)mt24110_ring_min(t->batch, t->items - next + 1);
+        for (int i = 0; i < n; i++) items[i] = (void *)(intptr_t)(next + i);
+        size_t done = 0;
+        while (done < (size_t)n) {
+            size_t k = mt24110_spsc_push_batch(t->ring, items + done, n - done);
+            if (k == 0) mt24110_backoff(&fails);
+            done += k;
+        }
+        next += n;
+    }
+    return NULL;
+}
+
+static void *mt24110_spsc_consumer(void *arg) {
+    MT24110_BenchThread *t = arg;
+    mt24110_pin(t->cpu);
+    void *items[MT24110_BENCH_MAX_BATCH];
+    int fails = 0;
+
+    for (long got = 0; got < t->items;) {
+        size_t k = mt24110_spsc_pop_batch(t->ring, items, t->batch);
+        if (k == 0) {
+            mt24110_backoff(&fails);
+            continue;
+        }
+        for (size_t i = 0; i < k; i++) t->checksum += (intptr_t)items[i];
+        got += k;
+    }
+    return NULL;
+}
+
+static void *mt24110_spsc_wait_producer(void *arg) {
+    MT24110_BenchThread *t = arg;
+    mt24110_pin(t->cpu);
+    for (long i = 1; i <= t->items; i++) {
+        mt24110_spsc_push_wait(t->ring, (void *)(intptr_t)i);
+    }
+    return NULL;
+}
+
+static void *mt24110_spsc_wait_consumer(void *arg) {
+    MT24110_BenchThread *t = arg;
+    mt24110_pin(t->cpu);
+    void *item;
+    for (long i = 0; i < t->items && mt24110_spsc_pop_wait(t->ring, &item); i++) {
+        t->checksum += (intptr_t)item;
+    }
+    return NULL;
+}
+
+/* Bounce every item straight back on the reply ring */
+static void *mt24110_pingpong_echo(void *arg) {
+    MT24110_BenchThread *t = arg;
+    mt24110_pin(t->cpu);
+    void *item;
+    int fails = 0;
+
+    for (long i = 0; i < t->items; i++) {
+        while (!mt24110_spsc_pop(t->ring, &item)) mt24110_backoff(&fails);
+        while (!mt24110_spsc_push(t->reply, item)) mt24110_backoff(&fails);
+    }
+    return NULL;
+}
+
+static void *mt24110_pingpong_sender(void *arg) {
+    MT24110_BenchThread *t = arg;
+    mt24110_pin(t->cpu);
+    void *item;
+    int fails = 0;
+
+    for (long i = 1; i <= t->items; i++) {
+        while (!mt24110_spsc_push(t->ring, (void *)(intptr_t)i)) mt24110_backoff(&fails);
+        while (!mt24110_spsc_pop(t->reply, &item)) mt24110_backoff(&fails);
+        t->checksum += (intptr_t)item;
+    }
+    return NULL;
+}
+
+static void *mt24110_mpsc_producer(void *arg) {
+    MT24110_BenchThread *t = arg;
+    mt24110_pin(t->cpu);
+    void *items[MT24110_BENCH_MAX_BATCH];
+    int fails = 0;
+
+    for (long next = 1; next <= t->items;) {
+        int n = (int)mt24110_ring_min(t->batch, t->items - next + 1);
+        for (int i = 0; i < n; i++) items[i] = (void *)(intptr_t)(next + i);
+        size_t done = 0;
+        while (done < (size_t)n) {
+            size_t k = mt24110_mpsc_push_batch(t->mpsc, items + done, n - done);
+            if (k == 0) mt24110_backoff(&fails);
+            done += k;
+        }
+        next += n;
+    }
+    return NULL;
+}
+
+static void *mt24110_mpsc_consumer(void *arg) {
+    MT24110_BenchThread *t = arg;
+    mt24110_pin(t->cpu);
+    void *items[MT24110_BENCH_MAX_BATCH];
+    int fails = 0;
+
+    for (long got = 0; got < t->items;) {
+        size_t k = mt24110_mpsc_pop_batch(t->mpsc, items, t->batch);
+        if (k == 0) {
+            mt24110_backoff(&fails);
+            continue;
+        }
+        for (size_t i = 0; i < k; i++) t->checksum += (intptr_t)items[i];
+        got += k;
+    }
+    return NULL;
+}
+
+/* Run producer/consumer once; returns seconds, -1 if the sum is wrong */
+static double mt24110_run_pair(void *(*producer)(void *), void *(*consumer)(void *),
+                               MT24110_BenchThread *p, MT24110_BenchThread *c, long expected) {
+    struct timespec start, end;
+    pthread_t pt, ct;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&ct, NULL, consumer, c);
+    pthread_create(&pt, NULL, producer, p);
+    pthread_join(pt, NULL);
+    pthread_join(ct, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    long sum = c->checksum + p->checksum;
+    return sum == expected ? mt24110_elapsed_s(&start, &end) : -1;
+}
+
+static void mt24110_print_row(const char *name, const MT24110_CpuPair *pair, long items, double secs) {
+    if (secs < 0) {
+        printf("%-12s %3d:%-3d  checksum mismatch\n", name, pair->producer_cpu, pair->consumer_cpu);
+        return;
+    }
+    printf("%-12s %3d:%-3d %12.2f %12.1f\n", name, pair->producer_cpu, pair->consumer_cpu,
+           items / secs / 1e6, secs * 1e9 / items);
+}
+
+static void mt24110_bench_pair(const MT24110_CpuPair *pair, long items, int batch) {
+    /* Only the _wait row sleeps; the others skip the wake-up fence */
+    MT24110_SpscRing ring, reply, waiting;
+    if (mt24110_spsc_init(&ring, MT24110_BENCH_RING_SIZE, MT24110_RING_NONBLOCKING) < 0 ||
+        mt24110_spsc_init(&reply, MT24110_BENCH_RING_SIZE, MT24110_RING_NONBLOCKING) < 0 ||
+        mt24110_spsc_init(&waiting, MT24110_BENCH_RING_SIZE, MT24110_RING_BLOCKING) < 0) {
+        perror("ring init failed");
+        exit(EXIT_FAILURE);
+    }
+    long expected = items * (items + 1) / 2;
+
+    MT24110_BenchThread p = { &ring, &reply, NULL, items, 1, pair->producer_cpu, 0 };
+    MT24110_BenchThread c = { &ring, &reply, NULL, items, 1, pair->consumer_cpu, 0 };
+    double secs = mt24110_run_pair(mt24110_spsc_producer, mt24110_spsc_consumer, &p, &c, expected);
+    mt24110_print_row("spsc", pair, items, secs);
+
+    p.batch = c.batch = batch;
+    c.checksum = 0;
+    secs = mt24110_run_pair(mt24110_spsc_producer, mt24110_spsc_consumer, &p, &c, expected);
+    mt24110_print_row("spsc-batch", pair, items, secs);
+
+    c.checksum = 0;
+    p.ring = c.ring = &waiting;
+    secs = mt24110_run_pair(mt24110_spsc_wait_producer, mt24110_spsc_wait_consumer, &p, &c, expected);
+    mt24110_print_row("spsc-wait", pair, items, secs);
+
+    /* Round trips are slow on a shared core; a tenth of the items is plenty */
+    long trips = items / 10 + 1;
+    MT24110_BenchThread sender = { &ring, &reply, NULL, trips, 1, pair->producer_cpu, 0 };
+    MT24110_BenchThread echo = { &ring, &reply, NULL, trips, 1, pair->consumer_cpu, 0 };
+    secs = mt24110_run_pair(mt24110_pingpong_sender, mt24110_pingpong_echo, &sender, &echo,
+                            trips * (trips + 1) / 2);
+    if (secs < 0) {
+        mt24110_print_row("pingpong", pair, trips, secs);
+    } else {
+        printf("%-12s %3d:%-3d %12.2f %12.1f  (one-way latency)\n", "pingpong",
+               pair->producer_cpu, pair->consumer_cpu, trips / secs / 1e6, secs * 1e9 / trips / 2);
+    }
+
+    mt24110_spsc_destroy(&ring);
+    mt24110_spsc_destroy(&reply);
+    mt24110_spsc_destroy(&waiting);
+}
+
+static void mt24110_bench_mpsc(const MT24110_CpuPair *pair, long items, int batch, int producers) {
+    MT24110_MpscRing ring;
+    if (mt24110_mpsc_init(&ring, MT24110_BENCH_RING_SIZE, MT24110_RING_NONBLOCKING) < 0) {
+        perror("ring init failed");
+        exit(EXIT_FAILURE);
+    }
+
+    long per_producer = items / producers;
+    MT24110_BenchThread threads[producers];
+    pthread_t tids[producers];
+    MT24110_BenchThread consumer = { NULL, NULL, &ring, per_producer * producers, batch,
+                                     pair->consumer_cpu, 0 };
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t ct;
+    pthread_create(&ct, NULL, mt24110_mpsc_consumer, &consumer);
+    for (int i = 0; i < producers; i++) {
+        /* Producers fill the CPUs other than the consumer's first */
+        threads[i] = (MT24110_BenchThread){ NULL, NULL, &ring, per_producer, batch,
+                                            pair->consumer_cpu + 1 + i, 0 };
+        pthread_create(&tids[i], NULL, mt24110_mpsc_producer, &threads[i]);
+    }
+    for (int i = 0; i < producers; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    pthread_join(ct, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    char name[16];
+    snprintf(name, sizeof(name), "mpsc-%d", producers);
+    long expected = producers * (per_producer * (per_producer + 1) / 2);
+    mt24110_print_row(name, pair, per_producer * producers,
+                      consumer.checksum == expected ? mt24110_elapsed_s(&start, &end) : -1);
+    mt24110_mpsc_destroy(&ring);
+}
+
+int main(int argc, char *argv[]) {
+    long items = MT24110_BENCH_DEFAULT_ITEMS;
+    int batch = MT24110_BENCH_DEFAULT_BATCH;
+    if (argc > 1) items = atol(argv[1]);
+    if (argc > 2) batch = atoi(argv[2]);
+    if (items <= 0 || batch <= 0 || batch > MT24110_BENCH_MAX_BATCH) {
+        fprintf(stderr, "Usage: %s [items [batch (1-%d) [PRODUCER:CONSUMER ...]]]\n",
+                argv[0], MT24110_BENCH_MAX_BATCH);
+        return 1;
+    }
+
+    num_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_cpus < 1) num_cpus = 1;
+
+    /* Default pairs: same core, neighbour, far half of the CPU list */
+    MT24110_CpuPair pairs[argc > 3 ? argc - 3 : 3];
+    int num_pairs = 0;
+    if (argc > 3) {
+        for (int i = 3; i < argc; i++) {
+            if (sscanf(argv[i], "%d:%d", &pairs[num_pairs].producer_cpu,
+                       &pairs[num_pairs].consumer_cpu) != 2) {
+                fprintf(stderr, "Invalid CPU pair: %s\n", argv[i]);
+                return 1;
+            }
+            num_pairs++;
+        }
+    } else {
+        pairs[num_pairs++] = (MT24110_CpuPair){ 0, 0 };
+        if (num_cpus >= 2) pairs[num_pairs++] = (MT24110_CpuPair){ 0, 1 };
+        if (num_cpus >= 4) pairs[num_pairs++] = (MT24110_CpuPair){ 0, num_cpus / 2 };
+    }
+
+    printf("=== Ring buffers (%ld items, batch %d, ring %d slots, %d CPUs) ===\n",
+           items, batch, MT24110_BENCH_RING_SIZE, num_cpus);
+    printf("%-12s %7s %12s %12s\n", "case", "cpus", "Mitems/s", "ns/item");
+    for (int i = 0; i < num_pairs; i++) {
+        mt24110_bench_pair(&pairs[i], items, batch);
+        mt24110_bench_mpsc(&pairs[i], items, batch, MT24110_BENCH_MPSC_PRODUCERS);
+        printf("\n");
+    }
+    return 0;
+}
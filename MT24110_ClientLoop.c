@@ -0,0 +1,105 @@
+/*
+ * MT24110_ClientLoop.c
+ * Per-thread client state and the round-trip loops shared by A1/A2/A3
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_ClientLoop.h"
+
+/* Report why a loop stopped early; ETIMEDOUT is the drain cut-off */
+static void mt24110_report_loop_error(const MT24110_ThreadData *data, int error) {
+    if (error != 0 && error != ETIMEDOUT) {
+        fprintf(stderr, "Worker %d: %s\n", data->thread_id,
+                error == ECONNRESET ? "server closed connection" : strerror(error));
+    }
+}
+
+/*
+ * Run the loop picked at startup for a fixed-size workload and copy its
+ * counters into the thread data
+ */
+void mt24110_run_hot_loop(MT24110_ThreadData *data, const MT24110_LoopSetup *setup,
+                          MT24110_HotLoopFn hot_loop, char *send_buffer, char *recv_buffer) {
+    MT24110_HotLoopArgs args;
+    memset(&args, 0, sizeof(args));
+    args.fd = data->sock_fd;
+    args.send_buffer = send_buffer;
+    args.recv_buffer = recv_buffer;
+    args.size = setup->message_size;
+    args.path = setup->path;
+    args.running = setup->running;
+
+    hot_loop(&args);
+    mt24110_report_loop_error(data, args.error);
+
+    data->bytes_sent = args.bytes_sent + (long)args.in_flight * setup->message_size;
+    data->bytes_received = args.bytes_received;
+    data->messages_sent = args.messages + args.in_flight;
+    data->messages_received = args.messages;
+    data->total_latency_us = args.total_latency_us;
+    data->paths = args.paths;
+}
+
+/*
+ * Run the compression-stage frame loop and copy its counters into the
+ * thread data
+ */
+void mt24110_run_codec_loop(MT24110_ThreadData *data, const MT24110_LoopSetup *setup,
+                            const MT24110_CodecConfig *codec, char *payload,
+                            MT24110_SizeSampler *sampler) {
+    MT24110_CodecLoopArgs args;
+    memset(&args, 0, sizeof(args));
+    args.fd = data->sock_fd;
+    args.path = setup->path;
+    args.policy = setup->policy;
+    args.codec = codec;
+    args.payload = payload;
+    args.max_size = setup->max_size;
+    args.sampler = sampler;
+    args.seed = data->thread_id + 1;
+    args.running = setup->running;
+
+    mt24110_codec_loop(&args);
+    mt24110_report_loop_error(data, args.error);
+
+    data->bytes_sent = args.bytes_sent;
+    data->bytes_received = args.bytes_received;
+    data->messages_sent = args.messages + args.in_flight;
+    data->messages_received = args.messages;
+    data->total_latency_us = args.total_latency_us;
+    data->codec = args.counters;
+    data->paths = args.paths;
+}
+
+/*
+ * Run the pipelined coalescing loop and copy its counters into the
+ * thread data
+ */
+void mt24110_run_coalesce_loop(MT24110_ThreadData *data, const MT24110_LoopSetup *setup,
+                               const MT24110_CoalesceConfig *coalesce, char *payload,
+                               MT24110_SizeSampler *sampler) {
+    MT24110_CoalesceLoopArgs args;
+    memset(&args, 0, sizeof(args));
+    args.fd = data->sock_fd;
+    args.path = setup->coalesce_path;
+    args.coalesce = coalesce;
+    args.payload = payload;
+    args.max_size = setup->max_size;
+    args.sampler = sampler;
+    args.buckets = &data->buckets;
+    args.running = setup->running;
+
+    mt24110_coalesce_loop(&args);
+    mt24110_report_loop_error(data, args.error);
+
+    data->bytes_sent = args.bytes_sent;
+    data->bytes_received = args.bytes_received;
+    data->messages_sent = args.messages + args.in_flight;
+    data->messages_received = args.messages;
+    data->total_latency_us = args.total_latency_us;
+    data->coalesce = args.counters;
+    data->paths = args.paths;
+}
@@ -0,0 +1,59 @@
+/*
+ * MT24110_ClientLoop.h
+ * Per-thread client state and the round-trip loops shared by A1/A2/A3
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * A client worker runs exactly one loop, picked from the options: the
+ * specialized hot loop, the compression frame loop, the coalescing loop
+ * or the client's own per-message loop. The first three differ between
+ * the clients only in the copy path, so they are run from here and copy
+ * their counters into MT24110_ThreadData.
+ */
+
+#ifndef MT24110_CLIENTLOOP_H
+#define MT24110_CLIENTLOOP_H
+
+#include "MT24110_SizeDist.h"
+#include "MT24110_Transport.h"
+#include "MT24110_HotLoop.h"
+#include "MT24110_Codec.h"
+#include "MT24110_Coalesce.h"
+
+/* Thread-specific data */
+typedef struct {
+    int thread_id;
+    int sock_fd;
+    long bytes_sent;
+    long bytes_received;
+    long messages_sent;
+    long messages_received;
+    long total_latency_us;
+    MT24110_SizeBuckets buckets;
+    MT24110_CodecCounters codec;
+    MT24110_CoalesceCounters coalesce;
+    MT24110_PathCounters paths;
+} MT24110_ThreadData;
+
+/* What a client hands the shared loops */
+typedef struct {
+    MT24110_SendPath path;              /* hot loop and frame loop */
+    MT24110_SendPath coalesce_path;     /* one flush per call, not zero-copy */
+    const MT24110_CopyPolicy *policy;   /* frame loop: path by size, NULL: path */
+    int message_size;                   /* hot loop */
+    int max_size;                       /* serialized payload */
+    volatile int *running;
+} MT24110_LoopSetup;
+
+/* Function prototypes */
+void mt24110_run_hot_loop(MT24110_ThreadData *data, const MT24110_LoopSetup *setup,
+                          MT24110_HotLoopFn hot_loop, char *send_buffer, char *recv_buffer);
+void mt24110_run_codec_loop(MT24110_ThreadData *data, const MT24110_LoopSetup *setup,
+                            const MT24110_CodecConfig *codec, char *payload,
+                            MT24110_SizeSampler *sampler);
+void mt24110_run_coalesce_loop(MT24110_ThreadData *data, const MT24110_LoopSetup *setup,
+                               const MT24110_CoalesceConfig *coalesce, char *payload,
+                               MT24110_SizeSampler *sampler);
+
+#endif /* MT24110_CLIENTLOOP_H */
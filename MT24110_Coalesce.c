@@ -0,0 +1,376 @@
+/*
+ * MT24110_Coalesce.c
+ * Client-side request coalescing (user-space Nagle) with selectable flush policy
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_Coalesce.h"
+
+/* One message between append and its complete echo */
+typedef struct {
+    int size;
+    long long appended_ns;      /* relative to loop start */
+} MT24110_Pending;
+
+/*
+ * Send buffer layout:
+ *   [0, sent_off)          written, kept until compaction
+ *   [sent_off, flush_end)  flushed, waiting for the socket to take it
+ *   [flush_end, len)       appended, not flushed yet
+ */
+typedef struct {
+    char *buffer;
+    int capacity;
+    int len;
+    int flush_end;
+    int sent_off;
+    int unflushed;              /* messages in [flush_end, len) */
+    long long unflushed_since;  /* append time of the oldest of them */
+    long long unflushed_sum_ns; /* sum of their append times */
+} MT24110_Coalescer;
+
+static long long mt24110_coalesce_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Parse --coalesce=size:BYTES|deadline:US|explicit[:N] (NULL or off: disabled).
+ * Returns 0 on success, -1 on a malformed value.
+ */
+int mt24110_coalesce_config_parse(const char *spec, int window, long rate,
+                                  MT24110_CoalesceConfig *coalesce) {
+    memset(coalesce, 0, sizeof(*coalesce));
+    coalesce->window = window;
+    coalesce->rate = rate;
+
+    if (spec == NULL || strcmp(spec, "off") == 0) {
+        coalesce->enabled = 0;
+    } else if (strncmp(spec, "size:", 5) == 0 && atoi(spec + 5) > 0) {
+        coalesce->enabled = 1;
+        coalesce->policy = MT24110_FLUSH_SIZE;
+        coalesce->size_threshold = atoi(spec + 5);
+    } else if (strncmp(spec, "deadline:", 9) == 0 && atol(spec + 9) > 0) {
+        coalesce->enabled = 1;
+        coalesce->policy = MT24110_FLUSH_DEADLINE;
+        coalesce->deadline_us = atol(spec + 9);
+    } else if (strcmp(spec, "explicit") == 0 ||
+               (strncmp(spec, "explicit:", 9) == 0 && atoi(spec + 9) > 0)) {
+        coalesce->enabled = 1;
+        coalesce->policy = MT24110_FLUSH_EXPLICIT;
+        coalesce->burst = (spec[8] == ':') ? atoi(spec + 9) : window;
+    } else {
+        fprintf(stderr, "Invalid --coalesce '%s' (off, size:BYTES, deadline:US or explicit[:N])\n", spec);
+        return -1;
+    }
+
+    if (window <= 0) {
+        fprintf(stderr, "Invalid --window %d\n", window);
+        return -1;
+    }
+    if (coalesce->burst > window) {
+        fprintf(stderr, "explicit:%d bursts cannot exceed --window %d\n", coalesce->burst, window);
+        return -1;
+    }
+    if (rate < 0) {
+        fprintf(stderr, "Invalid --rate %ld\n", rate);
+        return -1;
+    }
+    if (!coalesce->enabled && (window != MT24110_COALESCE_DEFAULT_WINDOW || rate != 0)) {
+        fprintf(stderr, "--window and --rate need --coalesce\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Hand everything appended so far to the socket */
+static void mt24110_coalescer_flush(MT24110_Coalescer *c, MT24110_FlushReason reason,
+                                    long long now, MT24110_CoalesceCounters *counters) {
+    if (c->unflushed == 0) return;
+
+    counters->messages += c->unflushed;
+    counters->flushes++;
+    counters->flush_reasons[reason]++;
+    counters->flushed_bytes += c->len - c->flush_end;
+    counters->buffered_ns += (long)(c->unflushed * now - c->unflushed_sum_ns);
+
+    c->flush_end = c->len;
+    c->unflushed = 0;
+    c->unflushed_sum_ns = 0;
+}
+
+/* Drop written bytes from the front of the buffer */
+static void mt24110_coalescer_compact(MT24110_Coalescer *c) {
+    if (c->sent_off == 0) return;
+    memmove(c->buffer, c->buffer + c->sent_off, c->len - c->sent_off);
+    c->len -= c->sent_off;
+    c->flush_end -= c->sent_off;
+    c->sent_off = 0;
+}
+
+/* Non-blocking write of flushed bytes; the caller polls for POLLOUT */
+static int mt24110_coalescer_write(int fd, MT24110_Coalescer *c, MT24110_SendPath path) {
+    char *data = c->buffer + c->sent_off;
+    int len = c->flush_end - c->sent_off;
+
+    if (path == MT24110_PATH_SENDMSG) {
+        struct iovec iov = { .iov_base = data, .iov_len = len };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        return sendmsg(fd, &msg, MSG_DONTWAIT);
+    }
+    return send(fd, data, len, MSG_DONTWAIT);
+}
+
+/*
+ * Pipelined round-trip loop with user-space coalescing: append messages
+ * while the window and --rate allow, flush by policy, write and read
+ * without blocking and wait in poll() for the socket, the next message
+ * or the flush deadline. Latency runs from append to complete echo.
+ */
+void mt24110_coalesce_loop(MT24110_CoalesceLoopArgs *a) {
+    const MT24110_CoalesceConfig *cfg = a->coalesce;
+    const int window = cfg->window;
+    const long long deadline_ns = cfg->deadline_us * 1000LL;
+    const long long interval_ns = cfg->rate > 0 ? 1000000000LL / cfg->rate : 0;
+    const MT24110_SendPath path = a->path;
+
+    MT24110_Coalescer c;
+    memset(&c, 0, sizeof(c));
+    c.capacity = MT24110_COALESCE_BUFFER_SIZE;
+    if (cfg->size_threshold + a->max_size > c.capacity) {
+        c.capacity = cfg->size_threshold + a->max_size;
+    }
+    c.buffer = malloc(c.capacity);
+    char *recv_buffer = malloc(MT24110_COALESCE_BUFFER_SIZE);
+    MT24110_Pending *fifo = malloc(window * sizeof(*fifo));
+    MT24110_CHECK_NULL(c.buffer, "malloc coalesce buffer");
+    MT24110_CHECK_NULL(recv_buffer, "malloc coalesce recv buffer");
+    MT24110_CHECK_NULL(fifo, "malloc coalesce window");
+
+    int head = 0, in_flight = 0, head_received = 0;
+    int stopping = 0;
+
+    long long start = mt24110_coalesce_now_ns();
+    long send_at_us;
+    int next_size = mt24110_sampler_next(a->sampler, &send_at_us);
+    long long next_at = (send_at_us >= 0) ? start + send_at_us * 1000LL : start;
+
+    for (;;) {
+        long long now = mt24110_coalesce_now_ns();
+
+        if (!stopping && (!*a->running || mt24110_shutdown_requested())) {
+            stopping = 1;
+            mt24110_coalescer_flush(&c, MT24110_FLUSH_REASON_FINAL, now - start, &a->counters);
+        }
+
+        /* Append messages while the window and pacing allow */
+        int buffer_full = 0;
+        while (!stopping && in_flight < window && now >= next_at) {
+            if (c.len + next_size > c.capacity) {
+                mt24110_coalescer_compact(&c);
+                if (c.len + next_size > c.capacity) {
+                    mt24110_coalescer_flush(&c, MT24110_FLUSH_REASON_FULL, now - start, &a->counters);
+                    buffer_full = 1;
+                    break;
+                }
+            }
+
+            memcpy(c.buffer + c.len, a->payload, next_size);
+            c.len += next_size;
+            fifo[(head + in_flight) % window] = (MT24110_Pending){ next_size, now - start };
+            in_flight++;
+            if (c.unflushed++ == 0) c.unflushed_since = now;
+            c.unflushed_sum_ns += now - start;
+
+            if (cfg->policy == MT24110_FLUSH_SIZE && c.len - c.flush_end >= cfg->size_threshold) {
+                mt24110_coalescer_flush(&c, MT24110_FLUSH_REASON_SIZE, now - start, &a->counters);
+            } else if (cfg->policy == MT24110_FLUSH_EXPLICIT && c.unflushed == cfg->burst) {
+                mt24110_coalescer_flush(&c, MT24110_FLUSH_REASON_BURST, now - start, &a->counters);
+            }
+
+            next_size = mt24110_sampler_next(a->sampler, &send_at_us);
+            if (send_at_us >= 0) {
+                next_at = start + send_at_us * 1000LL;
+            } else if (interval_ns > 0) {
+                next_at += interval_ns;
+            }
+        }
+
+        /*
+         * A full window ends the burst; nothing more can be appended. For
+         * explicit, a paced workload with nothing more due has ended its
+         * burst too.
+         */
+        if (c.unflushed > 0) {
+            if (in_flight == window) {
+                mt24110_coalescer_flush(&c, MT24110_FLUSH_REASON_WINDOW, now - start, &a->counters);
+            } else if (cfg->policy == MT24110_FLUSH_EXPLICIT && !buffer_full && now < next_at) {
+                mt24110_coalescer_flush(&c, MT24110_FLUSH_REASON_BURST, now - start, &a->counters);
+            } else if (cfg->policy == MT24110_FLUSH_DEADLINE && now - c.unflushed_since >= deadline_ns) {
+                mt24110_coalescer_flush(&c, MT24110_FLUSH_REASON_DEADLINE, now - start, &a->counters);
+            }
+        }
+
+        /* One syscall for everything flushed */
+        if (c.sent_off < c.flush_end) {
+            int w = mt24110_coalescer_write(a->fd, &c, path);
+            if (w > 0) {
+                a->counters.send_calls++;
+                a->paths.messages[path]++;
+                a->paths.bytes[path] += w;
+                a->bytes_sent += w;
+                c.sent_off += w;
+                if (c.sent_off == c.flush_end) mt24110_coalescer_compact(&c);
+            } else if (w < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                a->error = errno;
+                break;
+            }
+        }
+
+        /* Match echoed bytes to messages in send order */
+        int r;
+        while ((r = recv(a->fd, recv_buffer, MT24110_COALESCE_BUFFER_SIZE, MSG_DONTWAIT)) > 0) {
+            long long done = mt24110_coalesce_now_ns() - start;
+            a->counters.recv_calls++;
+            a->bytes_received += r;
+
+            while (r > 0 && in_flight > 0) {
+                MT24110_Pending *p = &fifo[head];
+                int take = MT24110_MIN(r, p->size - head_received);
+                head_received += take;
+                r -= take;
+                if (head_received == p->size) {
+                    long latency = (long)((done - p->appended_ns) / 1000);
+                    a->messages++;
+                    a->total_latency_us += latency;
+                    if (a->buckets != NULL) {
+                        mt24110_buckets_add(a->buckets, p->size, latency);
+                    }
+                    head = (head + 1) % window;
+                    in_flight--;
+                    head_received = 0;
+                }
+            }
+            if (r > 0) {
+                a->error = EBADMSG;     /* echo of bytes never sent */
+                break;
+            }
+        }
+        if (a->error != 0) break;
+        if (r == 0) {
+            a->error = ECONNRESET;
+            break;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            a->error = errno;
+            break;
+        }
+
+        if (stopping && in_flight == 0) break;
+
+        /* Sleep until the socket is ready, the next message is due or the deadline hits */
+        now = mt24110_coalesce_now_ns();
+        long timeout_us = -1;
+        if (!stopping && !buffer_full && in_flight < window) {
+            timeout_us = (next_at > now) ? (long)((next_at - now + 999) / 1000) : 0;
+        }
+        if (cfg->policy == MT24110_FLUSH_DEADLINE && c.unflushed > 0) {
+            long long due = c.unflushed_since + deadline_ns - now;
+            long due_us = (due > 0) ? (long)((due + 999) / 1000) : 0;
+            if (timeout_us < 0 || due_us < timeout_us) timeout_us = due_us;
+        }
+        if (timeout_us == 0) continue;
+
+        short events = POLLIN | (c.sent_off < c.flush_end ? POLLOUT : 0);
+        int ready = mt24110_wait_fd_timeout(a->fd, events, stopping, timeout_us);
+        if (ready < 0) {
+            a->error = errno;
+            break;
+        }
+        if (ready == 0 && stopping) {
+            a->error = ETIMEDOUT;       /* drain deadline passed */
+            break;
+        }
+    }
+
+    a->in_flight = in_flight;
+    free(c.buffer);
+    free(recv_buffer);
+    free(fifo);
+}
+
+void mt24110_coalesce_stats_init(MT24110_CoalesceStats *stats) {
+    atomic_init(&stats->messages, 0);
+    atomic_init(&stats->flushes, 0);
+    for (int i = 0; i < MT24110_FLUSH_REASON_COUNT; i++) {
+        atomic_init(&stats->flush_reasons[i], 0);
+    }
+    atomic_init(&stats->send_calls, 0);
+    atomic_init(&stats->recv_calls, 0);
+    atomic_init(&stats->flushed_bytes, 0);
+    atomic_init(&stats->buffered_ns, 0);
+}
+
+void mt24110_coalesce_stats_merge(MT24110_CoalesceStats *stats, const MT24110_CoalesceCounters *c) {
+    atomic_fetch_add(&stats->messages, c->messages);
+    atomic_fetch_add(&stats->flushes, c->flushes);
+    for (int i = 0; i < MT24110_FLUSH_REASON_COUNT; i++) {
+        atomic_fetch_add(&stats->flush_reasons[i], c->flush_reasons[i]);
+    }
+    atomic_fetch_add(&stats->send_calls, c->send_calls);
+    atomic_fetch_add(&stats->recv_calls, c->recv_calls);
+    atomic_fetch_add(&stats->flushed_bytes, c->flushed_bytes);
+    atomic_fetch_add(&stats->buffered_ns, c->buffered_ns);
+}
+
+void mt24110_coalesce_stats_print(MT24110_CoalesceStats *stats, const MT24110_CoalesceConfig *coalesce) {
+    long messages = atomic_load(&stats->messages);
+    long flushes = atomic_load(&stats->flushes);
+    long sends = atomic_load(&stats->send_calls);
+    long recvs = atomic_load(&stats->recv_calls);
+    long bytes = atomic_load(&stats->flushed_bytes);
+    long buffered = atomic_load(&stats->buffered_ns);
+
+    printf("\n=== Coalescing (");
+    switch (coalesce->policy) {
+    case MT24110_FLUSH_SIZE:
+        printf("size:%d", coalesce->size_threshold);
+        break;
+    case MT24110_FLUSH_DEADLINE:
+        printf("deadline:%ldus", coalesce->deadline_us);
+        break;
+    case MT24110_FLUSH_EXPLICIT:
+        printf("explicit:%d", coalesce->burst);
+        break;
+    }
+    printf(", window %d, ", coalesce->window);
+    if (coalesce->rate > 0) {
+        printf("%ld msgs/s per thread) ===\n", coalesce->rate);
+    } else {
+        printf("unpaced) ===\n");
+    }
+    if (flushes == 0) {
+        printf("No flushes completed\n");
+        return;
+    }
+
+    printf("Flushes: %ld (%.1f messages, %.0f bytes per flush)\n",
+           flushes, (double)messages / flushes, (double)bytes / flushes);
+    printf("Syscalls: %ld send (%.3f per message), %ld recv (%.3f per message)\n",
+           sends, (double)sends / messages, recvs, (double)recvs / messages);
+    printf("Flush reasons: size %ld, deadline %ld, burst %ld, window %ld, buffer full %ld, final %ld\n",
+           atomic_load(&stats->flush_reasons[MT24110_FLUSH_REASON_SIZE]),
+           atomic_load(&stats->flush_reasons[MT24110_FLUSH_REASON_DEADLINE]),
+           atomic_load(&stats->flush_reasons[MT24110_FLUSH_REASON_BURST]),
+           atomic_load(&stats->flush_reasons[MT24110_FLUSH_REASON_WINDOW]),
+           atomic_load(&stats->flush_reasons[MT24110_FLUSH_REASON_FULL]),
+           atomic_load(&stats->flush_reasons[MT24110_FLUSH_REASON_FINAL]));
+    printf("Added buffering delay: %.2f us per message\n", buffered / 1e3 / messages);
+}
@@ -0,0 +1,111 @@
+/*
+ * MT24110_Coalesce.h
+ * Client-side request coalescing (user-space Nagle) with selectable flush policy
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * Instead of one send() per message, messages are appended to a
+ * per-connection send buffer and written with one syscall per flush.
+ * Up to `window` messages may be in flight, so the loop is pipelined and
+ * event driven (non-blocking send/recv + poll) rather than lock-step.
+ * A batch is flushed when:
+ *   size:N       - N or more unflushed bytes are buffered
+ *   deadline:US  - the oldest unflushed message has waited US microseconds
+ *   explicit[:N] - the workload ends a burst: N messages appended (default
+ *                  and at most: window) or, when paced by --rate or a
+ *                  trace, no further message is due yet
+ * Every policy also flushes when the window is full, when the buffer has
+ * no room for the next message and on shutdown. TCP_NODELAY stays set:
+ * the batching happens in user space, with a bounded added delay.
+ */
+
+#ifndef MT24110_COALESCE_H
+#define MT24110_COALESCE_H
+
+#include <stdatomic.h>
+#include "MT24110_SizeDist.h"
+#include "MT24110_Transport.h"
+
+#define MT24110_COALESCE_BUFFER_SIZE (64 * 1024)
+
+typedef enum {
+    MT24110_FLUSH_SIZE,
+    MT24110_FLUSH_DEADLINE,
+    MT24110_FLUSH_EXPLICIT,
+} MT24110_FlushPolicy;
+
+/* Why a batch was flushed */
+typedef enum {
+    MT24110_FLUSH_REASON_SIZE,
+    MT24110_FLUSH_REASON_DEADLINE,
+    MT24110_FLUSH_REASON_BURST,
+    MT24110_FLUSH_REASON_WINDOW,
+    MT24110_FLUSH_REASON_FULL,
+    MT24110_FLUSH_REASON_FINAL,
+    MT24110_FLUSH_REASON_COUNT
+} MT24110_FlushReason;
+
+typedef struct {
+    int enabled;
+    MT24110_FlushPolicy policy;
+    int size_threshold;         /* size:N */
+    long deadline_us;           /* deadline:US */
+    int burst;                  /* explicit[:N]: messages per burst, <= window */
+    int window;                 /* --window: messages in flight */
+    long rate;                  /* --rate: messages/s per thread, 0 = unpaced */
+} MT24110_CoalesceConfig;
+
+/* Per-thread counters, merged into MT24110_CoalesceStats at thread exit */
+typedef struct {
+    long messages;
+    long flushes;
+    long flush_reasons[MT24110_FLUSH_REASON_COUNT];
+    long send_calls;
+    long recv_calls;
+    long flushed_bytes;
+    long buffered_ns;           /* append -> flush, summed over messages */
+} MT24110_CoalesceCounters;
+
+typedef struct {
+    atomic_long messages;
+    atomic_long flushes;
+    atomic_long flush_reasons[MT24110_FLUSH_REASON_COUNT];
+    atomic_long send_calls;
+    atomic_long recv_calls;
+    atomic_long flushed_bytes;
+    atomic_long buffered_ns;
+} MT24110_CoalesceStats;
+
+/* Arguments and results of one thread's coalescing loop */
+typedef struct {
+    /* Inputs */
+    int fd;
+    MT24110_SendPath path;      /* send or sendmsg per flush, not zero-copy */
+    const MT24110_CoalesceConfig *coalesce;
+    const char *payload;        /* serialized message, max_size bytes */
+    int max_size;
+    MT24110_SizeSampler *sampler;   /* per-message sizes, trace offsets pace */
+    MT24110_SizeBuckets *buckets;   /* per-size latency, NULL: not recorded */
+    volatile int *running;
+
+    /* Outputs */
+    long messages;
+    long bytes_sent;
+    long bytes_received;
+    long total_latency_us;      /* append -> echo, includes buffering delay */
+    int error;
+    int in_flight;              /* messages without a complete echo at exit */
+    MT24110_CoalesceCounters counters;
+    MT24110_PathCounters paths;
+} MT24110_CoalesceLoopArgs;
+
+/* Function prototypes */
+int mt24110_coalesce_config_parse(const char *spec, int window, long rate,
+                                  MT24110_CoalesceConfig *coalesce);
+void mt24110_coalesce_loop(MT24110_CoalesceLoopArgs *args);
+void mt24110_coalesce_stats_init(MT24110_CoalesceStats *stats);
+void mt24110_coalesce_stats_merge(MT24110_CoalesceStats *stats, const MT24110_CoalesceCounters *c);
+void mt24110_coalesce_stats_print(MT24110_CoalesceStats *stats, const MT24110_CoalesceConfig *coalesce);
+
+#endif /* MT24110_COALESCE_H */
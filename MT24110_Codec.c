@@ -0,0 +1,476 @@
+/*
+ * MT24110_Codec.c
+ * Optional payload compression stage with a bundled LZ4-style codec
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_Codec.h"
+#include <limits.h>
+
+#define MT24110_LZ_MIN_MATCH 4
+#define MT24110_LZ_MAX_OFFSET 65535
+/* Block format end rules: last match starts >= 12 bytes before the end,
+ * the last 5 bytes are always literals */
+#define MT24110_LZ_MF_LIMIT 12
+#define MT24110_LZ_LAST_LITERALS 5
+#define MT24110_LZ_HASH_LOG_SMALL 10
+#define MT24110_LZ_HASH_LOG 12
+
+static inline uint32_t mt24110_read32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t mt24110_read64(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t mt24110_lz_hash(uint32_t seq, int hash_log) {
+    return (seq * 2654435761U) >> (32 - hash_log);
+}
+
+/* Length of the common prefix of a and b, not reading past limit */
+static inline int mt24110_lz_match_length(const char *a, const char *b, const char *limit) {
+    const char *start = a;
+    while (a + 8 <= limit) {
+        uint64_t diff = mt24110_read64(a) ^ mt24110_read64(b);
+        if (diff != 0) {
+            return (int)(a - start) + (__builtin_ctzll(diff) >> 3);
+        }
+        a += 8;
+        b += 8;
+    }
+    while (a < limit && *a == *b) {
+        a++;
+        b++;
+    }
+    return (int)(a - start);
+}
+
+/* Write a 4-bit field's overflow as 255-runs plus remainder */
+static inline char *mt24110_lz_write_length(char *op, int len) {
+    for (; len >= 255; len -= 255) {
+        *op++ = (char)255;
+    }
+    *op++ = (char)len;
+    return op;
+}
+
+/*
+ * Worst-case compressed size of len input bytes
+ */
+int mt24110_lz_bound(int len) {
+    return len + len / 255 + 16;
+}
+
+/*
+ * Compress src into dst. Returns the compressed size, or -1 if it does
+ * not fit in capacity (the caller then sends the data stored).
+ */
+int mt24110_lz_compress(const char *src, int len, char *dst, int capacity) {
+    /* Small inputs get a small table: clearing it is part of the cost */
+    int hash_log = (len < 4096) ? MT24110_LZ_HASH_LOG_SMALL : MT24110_LZ_HASH_LOG;
+    uint32_t table[1 << MT24110_LZ_HASH_LOG];
+    memset(table, 0, sizeof(uint32_t) << hash_log);
+
+    const char *ip = src;
+    const char *anchor = src;
+    const char *end = src + len;
+    const char *match_limit = end - MT24110_LZ_LAST_LITERALS;
+    const char *start_limit = (len >= MT24110_LZ_MF_LIMIT) ? end - MT24110_LZ_MF_LIMIT : src;
+    char *op = dst;
+    char *op_end = dst + capacity;
+
+    while (ip < start_limit) {
+        uint32_t seq = mt24110_read32(ip);
+        uint32_t h = mt24110_lz_hash(seq, hash_log);
+        const char *ref = src + table[h];
+        table[h] = (uint32_t)(ip - src);
+
+        if (ref >= ip || ip - ref > MT24110_LZ_MAX_OFFSET || mt24110_read32(ref) != seq) {
+            /* Skip faster through data that keeps failing to match */
+            ip += 1 + ((ip - anchor) >> 6);
+            continue;
+        }
+
+        int literals = (int)(ip - anchor);
+        int match = MT24110_LZ_MIN_MATCH +
+                    mt24110_lz_match_length(ip + MT24110_LZ_MIN_MATCH, ref + MT24110_LZ_MIN_MATCH,
+                                            match_limit);
+
+        /* token + literal length bytes + literals + offset + match length bytes */
+        if (op + 1 + literals / 255 + 1 + literals + 2 + (match - MT24110_LZ_MIN_MATCH) / 255 + 1 > op_end) {
+            return -1;
+        }
+
+        char *token = op++;
+        int lit_code = literals < 15 ? literals : 15;
+        int match_code = (match - MT24110_LZ_MIN_MATCH) < 15 ? (match - MT24110_LZ_MIN_MATCH) : 15;
+        *token = (char)((lit_code << 4) | match_code);
+        if (literals >= 15) {
+            op = mt24110_lz_write_length(op, literals - 15);
+        }
+        memcpy(op, anchor, literals);
+        op += literals;
+
+        uint16_t offset = (uint16_t)(ip - ref);
+        *op++ = (char)(offset & 0xff);
+        *op++ = (char)(offset >> 8);
+        if (match - MT24110_LZ_MIN_MATCH >= 15) {
+            op = mt24110_lz_write_length(op, match - MT24110_LZ_MIN_MATCH - 15);
+        }
+
+        ip += match;
+        anchor = ip;
+    }
+
+    /* Trailing literals */
+    int literals = (int)(end - anchor);
+    if (op + 1 + literals / 255 + 1 + literals > op_end) {
+        return -1;
+    }
+    char *token = op++;
+    *token = (char)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) {
+        op = mt24110_lz_write_length(op, literals - 15);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+
+    return (int)(op - dst);
+}
+
+/* Read a 255-run length extension; -1 if it runs past end */
+static inline int mt24110_lz_read_length(const unsigned char **ip, const unsigned char *end) {
+    int len = 0;
+    unsigned char b;
+    do {
+        if (*ip >= end) return -1;
+        b = *(*ip)++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+/*
+ * Decompress src into dst. Returns the decoded size, or -1 if the input
+ * is malformed or would overflow capacity.
+ */
+int mt24110_lz_decompress(const char *src, int len, char *dst, int capacity) {
+    const unsigned char *ip = (const unsigned char *)src;
+    const unsigned char *end = ip + len;
+    char *op = dst;
+    char *op_end = dst + capacity;
+
+    while (ip < end) {
+        int token = *ip++;
+
+        int literals = token >> 4;
+        if (literals == 15) {
+            int extra = mt24110_lz_read_length(&ip, end);
+            if (extra < 0) return -1;
+            literals += extra;
+        }
+        if (literals > end - ip || literals > op_end - op) return -1;
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+
+        /* The last sequence has literals only */
+        if (ip >= end) break;
+
+        if (end - ip < 2) return -1;
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst) return -1;
+
+        int match = token & 15;
+        if (match == 15) {
+            int extra = mt24110_lz_read_length(&ip, end);
+            if (extra < 0) return -1;
+            match += extra;
+        }
+        match += MT24110_LZ_MIN_MATCH;
+        if (match > op_end - op) return -1;
+
+        const char *ref = op - offset;
+        if (offset >= match) {
+            memcpy(op, ref, match);
+            op += match;
+        } else {
+            /* Overlapping: the run repeats the last offset bytes, and each
+             * chunk copied doubles the distance to ref */
+            while (match > 0) {
+                int chunk = (int)(op - ref) < match ? (int)(op - ref) : match;
+                memcpy(op, ref, chunk);
+                op += chunk;
+                match -= chunk;
+            }
+        }
+    }
+    return (int)(op - dst);
+}
+
+/*
+ * Parse --compress=off|message|batch:N, --compress-min and
+ * --payload=pattern|random. max_size is the largest serialized message;
+ * a frame of N of them, compressed, must fit in an int. Returns 0 on
+ * success, -1 on error.
+ */
+int mt24110_codec_config_parse(const char *compress, int min_size, const char *payload,
+                               int max_size, MT24110_CodecConfig *codec) {
+    memset(codec, 0, sizeof(*codec));
+    codec->batch = 1;
+    codec->min_size = min_size;
+
+    if (compress == NULL || strcmp(compress, "off") == 0) {
+        codec->enabled = 0;
+    } else if (strcmp(compress, "message") == 0) {
+        codec->enabled = 1;
+    } else if (strncmp(compress, "batch:", 6) == 0) {
+        char *end = NULL;
+        errno = 0;
+        long batch = strtol(compress + 6, &end, 10);
+        if (compress[6] == '\0' || *end != '\0' || errno != 0 || batch <= 0 || batch > INT_MAX) {
+            fprintf(stderr, "Invalid --compress '%s' (batch:N needs a positive N)\n", compress);
+            return -1;
+        }
+        codec->enabled = 1;
+        codec->batch = (int)batch;
+    } else {
+        fprintf(stderr, "Invalid --compress '%s' (off, message or batch:N)\n", compress);
+        return -1;
+    }
+
+    /* Raw, wire and receive frames are sized in int: header + LZ bound of the batch */
+    long long raw = (long long)codec->batch * max_size;
+    if (raw + raw / 255 + 16 + (long long)sizeof(MT24110_FrameHeader) > INT_MAX) {
+        fprintf(stderr, "Invalid --compress '%s': %d messages of up to %d bytes do not fit in a frame\n",
+                compress, codec->batch, max_size);
+        return -1;
+    }
+
+    if (min_size < 0) {
+        fprintf(stderr, "Invalid --compress-min %d\n", min_size);
+        return -1;
+    }
+
+    if (payload != NULL && !codec->enabled) {
+        fprintf(stderr, "--payload needs --compress\n");
+        return -1;
+    }
+    if (payload == NULL || strcmp(payload, "pattern") == 0) {
+        codec->random_payload = 0;
+    } else if (strcmp(payload, "random") == 0) {
+        codec->random_payload = 1;
+    } else {
+        fprintf(stderr, "Invalid --payload '%s' (pattern or random)\n", payload);
+        return -1;
+    }
+    return 0;
+}
+
+static long mt24110_elapsed_ns(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * 1000000000L + (to->tv_nsec - from->tv_nsec);
+}
+
+/* Receive exactly len bytes. Returns 0 or the errno to report. */
+static int mt24110_codec_recv_exact(int fd, char *buffer, int len) {
+    int received = 0;
+    while (received < len) {
+        int r = recv(fd, buffer + received, len - received, 0);
+        if (r == 0) {
+            /* After shutdown, main cut off the drain */
+            return mt24110_shutdown_requested() ? ETIMEDOUT : ECONNRESET;
+        }
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return errno;
+        }
+        received += r;
+    }
+    return 0;
+}
+
+/*
+ * Round-trip loop with the compression stage: build a frame of one or
+ * more messages, compress it if worthwhile, send, receive the echo and
+ * decode it. Latency covers the codec work on both ends.
+ */
+void mt24110_codec_loop(MT24110_CodecLoopArgs *a) {
+    const MT24110_CodecConfig *codec = a->codec;
+    const int header = sizeof(MT24110_FrameHeader);
+    int raw_capacity = codec->batch * a->max_size;
+    int wire_capacity = mt24110_lz_bound(raw_capacity);
+
+    /* Stored frames are sent in place: the header slot sits before raw */
+    char *raw_frame = malloc(header + raw_capacity);
+    char *wire_frame = malloc(header + wire_capacity);
+    char *recv_frame = malloc(header + wire_capacity);
+    char *decoded = malloc(raw_capacity);
+    MT24110_CHECK_NULL(raw_frame, "malloc raw frame");
+    MT24110_CHECK_NULL(wire_frame, "malloc wire frame");
+    MT24110_CHECK_NULL(recv_frame, "malloc recv frame");
+    MT24110_CHECK_NULL(decoded, "malloc decoded frame");
+    char *raw = raw_frame + header;
+
+    /* A batch is the message repeated, or random bytes nothing can shrink */
+    if (codec->random_payload) {
+        uint64_t x = 0x9e3779b97f4a7c15ULL ^ a->seed;
+        for (int i = 0; i < raw_capacity; i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            raw[i] = (char)(x >> 32);
+        }
+    } else {
+        for (int i = 0; i < codec->batch; i++) {
+            memcpy(raw + (long)i * a->max_size, a->payload, a->max_size);
+        }
+    }
+
+    struct timespec start, t0, t1, end;
+
+    while (*a->running) {
+        int count = 0, raw_len = 0;
+        for (; count < codec->batch; count++) {
+            long unused;
+            raw_len += mt24110_sampler_next(a->sampler, &unused);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        int payload_len = -1;
+        if (raw_len >= codec->min_size) {
+            payload_len = mt24110_lz_compress(raw, raw_len, wire_frame + header, wire_capacity);
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            a->counters.compress_ns += mt24110_elapsed_ns(&start, &t0);
+        }
+
+        char *frame = wire_frame;
+        if (payload_len < 0 || payload_len >= raw_len) {
+            frame = raw_frame;
+            payload_len = raw_len;
+            a->counters.stored_frames++;
+        }
+        MT24110_FrameHeader hdr = { (uint32_t)raw_len, (uint32_t)payload_len };
+        memcpy(frame, &hdr, header);
+        int frame_len = header + payload_len;
+
+        MT24110_SendPath path = a->policy ? mt24110_select_path(a->policy, frame_len) : a->path;
+        int sent = mt24110_transport_send(a->fd, frame, frame_len, path, &a->paths);
+        if (sent != frame_len) {
+            a->error = (sent < 0) ? errno : EIO;
+            break;
+        }
+
+        int err = mt24110_codec_recv_exact(a->fd, recv_frame, frame_len);
+        if (err != 0) {
+            a->error = err;
+            a->in_flight = count;
+            a->bytes_sent += frame_len;
+            break;
+        }
+        if (a->paths.zc_pending > 0) {
+            mt24110_reap_zerocopy(a->fd, &a->paths, 0);
+        }
+
+        /* Decode what came back; stored frames are used in place */
+        memcpy(&hdr, recv_frame, header);
+        if (hdr.payload_len != hdr.raw_len) {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            int decoded_len = mt24110_lz_decompress(recv_frame + header, hdr.payload_len,
+                                                    decoded, raw_capacity);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            a->counters.decompress_ns += mt24110_elapsed_ns(&t0, &t1);
+            if (decoded_len != (int)hdr.raw_len) {
+                a->error = EBADMSG;
+                break;
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        long latency = mt24110_elapsed_ns(&start, &end) / 1000L;
+
+        a->messages += count;
+        a->total_latency_us += latency * count;
+        a->bytes_sent += frame_len;
+        a->bytes_received += frame_len;
+        a->counters.frames++;
+        a->counters.raw_bytes += raw_len;
+        a->counters.wire_bytes += frame_len;
+    }
+
+    free(raw_frame);
+    free(wire_frame);
+    free(recv_frame);
+    free(decoded);
+}
+
+void mt24110_codec_stats_init(MT24110_CodecStats *stats) {
+    atomic_init(&stats->frames, 0);
+    atomic_init(&stats->stored_frames, 0);
+    atomic_init(&stats->raw_bytes, 0);
+    atomic_init(&stats->wire_bytes, 0);
+    atomic_init(&stats->compress_ns, 0);
+    atomic_init(&stats->decompress_ns, 0);
+}
+
+void mt24110_codec_stats_merge(MT24110_CodecStats *stats, const MT24110_CodecCounters *c) {
+    atomic_fetch_add(&stats->frames, c->frames);
+    atomic_fetch_add(&stats->stored_frames, c->stored_frames);
+    atomic_fetch_add(&stats->raw_bytes, c->raw_bytes);
+    atomic_fetch_add(&stats->wire_bytes, c->wire_bytes);
+    atomic_fetch_add(&stats->compress_ns, c->compress_ns);
+    atomic_fetch_add(&stats->decompress_ns, c->decompress_ns);
+}
+
+/*
+ * Print ratio, codec CPU cost and application-level throughput
+ * (uncompressed bytes delivered per second)
+ */
+void mt24110_codec_stats_print(MT24110_CodecStats *stats, const MT24110_CodecConfig *codec,
+                               double duration, int num_threads) {
+    long frames = atomic_load(&stats->frames);
+    long stored = atomic_load(&stats->stored_frames);
+    long raw = atomic_load(&stats->raw_bytes);
+    long wire = atomic_load(&stats->wire_bytes);
+    long cns = atomic_load(&stats->compress_ns);
+    long dns = atomic_load(&stats->decompress_ns);
+
+    printf("\n=== Compression (");
+    if (codec->batch > 1) {
+        printf("batches of %d", codec->batch);
+    } else {
+        printf("per message");
+    }
+    printf(", min %d bytes, %s payload) ===\n", codec->min_size,
+           codec->random_payload ? "random" : "pattern");
+    if (frames == 0) {
+        printf("No frames completed\n");
+        return;
+    }
+
+    printf("Frames: %ld (%ld stored uncompressed)\n", frames, stored);
+    printf("Ratio: %.2f (raw %.2f MB -> wire %.2f MB)\n",
+           wire > 0 ? (double)raw / wire : 0, raw / 1e6, wire / 1e6);
+    /* Per raw byte, so codec and network costs add up per message */
+    if (cns > 0) {
+        printf("Compress: %.3f ns/byte (%.0f MB/s)\n", (double)cns / raw, raw * 1e3 / cns);
+    }
+    if (dns > 0) {
+        printf("Decompress: %.3f ns/byte (%.0f MB/s)\n", (double)dns / raw, raw * 1e3 / dns);
+    }
+    if (duration > 0 && num_threads > 0) {
+        printf("Codec CPU: %.1f%% of worker time\n",
+               100.0 * (cns + dns) / (duration * 1e9 * num_threads));
+        printf("Application throughput: %.4f Gbps (wire %.4f Gbps)\n",
+               raw * 8.0 / (duration * 1e9), wire * 8.0 / (duration * 1e9));
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * MT24110_Codec.h
+ * Optional payload compression stage with a bundled LZ4-style codec
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * The codec emits the LZ4 block format (token, literals, 16-bit offset,
+ * match length; greedy single-probe hash, 64KB window), favouring speed
+ * over ratio. Each frame on the wire is an 8-byte header followed by the
+ * payload: compressed if that made it smaller, stored otherwise. A frame
+ * carries one message or a batch of messages compressed together.
+ * The server echoes frames unchanged, so only the client encodes and
+ * decodes.
+ */
+
+#ifndef MT24110_CODEC_H
+#define MT24110_CODEC_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "MT24110_SizeDist.h"
+#include "MT24110_Transport.h"
+
+typedef struct {
+    uint32_t raw_len;           /* bytes after decoding */
+    uint32_t payload_len;       /* bytes following the header; == raw_len: stored */
+} MT24110_FrameHeader;
+
+typedef struct {
+    int enabled;
+    int batch;                  /* messages per frame, 1 = per message */
+    int min_size;               /* --compress-min */
+    int random_payload;         /* --payload=random: incompressible bytes */
+} MT24110_CodecConfig;
+
+/* Per-thread counters, merged into MT24110_CodecStats at thread exit */
+typedef struct {
+    long frames;
+    long stored_frames;
+    long raw_bytes;
+    long wire_bytes;
+    long compress_ns;
+    long decompress_ns;
+} MT24110_CodecCounters;
+
+typedef struct {
+    atomic_long frames;
+    atomic_long stored_frames;
+    atomic_long raw_bytes;
+    atomic_long wire_bytes;
+    atomic_long compress_ns;
+    atomic_long decompress_ns;
+} MT24110_CodecStats;
+
+/* Arguments and results of one thread's compressed round-trip loop */
+typedef struct {
+    /* Inputs */
+    int fd;
+    MT24110_SendPath path;
+    const MT24110_CopyPolicy *policy;   /* per-frame path by size, NULL: path */
+    const MT24110_CodecConfig *codec;
+    const char *payload;        /* serialized message, max_size bytes */
+    int max_size;
+    MT24110_SizeSampler *sampler;   /* per-message sizes, trace pacing ignored */
+    unsigned int seed;          /* random payload seed */
+    volatile int *running;
+
+    /* Outputs */
+    long messages;
+    long bytes_sent;            /* wire bytes incl. headers */
+    long bytes_received;
+    long total_latency_us;      /* frame round trip, counted once per message */
+    int error;
+    int in_flight;              /* messages in the frame awaiting its echo */
+    MT24110_CodecCounters counters;
+    MT24110_PathCounters paths;
+} MT24110_CodecLoopArgs;
+
+/* Function prototypes */
+int mt24110_lz_bound(int len);
+int mt24110_lz_compress(const char *src, int len, char *dst, int capacity);
+int mt24110_lz_decompress(const char *src, int len, char *dst, int capacity);
+int mt24110_codec_config_parse(const char *compress, int min_size, const char *payload,
+                               int max_size, MT24110_CodecConfig *codec);
+void mt24110_codec_loop(MT24110_CodecLoopArgs *args);
+void mt24110_codec_stats_init(MT24110_CodecStats *stats);
+void mt24110_codec_stats_merge(MT24110_CodecStats *stats, const MT24110_CodecCounters *c);
+void mt24110_codec_stats_print(MT24110_CodecStats *stats, const MT24110_CodecConfig *codec,
+                               double duration, int num_threads);
+
+#endif /* MT24110_CODEC_H */
@@ -6,7 +6,16 @@
  * Education: MTech at IIITD, CSE
  */
 
+#define _GNU_SOURCE
 #include "MT24110_Common.h"
+#include "MT24110_MemKernels.h"
+#include <sys/eventfd.h>
+
+/* Shutdown state shared by all threads; written from signal context */
+static int shutdown_efd = -1;
+static int shutdown_drain_ms = MT24110_DEFAULT_DRAIN_MS;
+static atomic_int shutdown_flag;
+static atomic_llong shutdown_deadline_ns;
 
 /*
  * Create a message with 8 dynamically allocated string fields
@@ -40,14 +49,14 @@ MT24110_Message *mt24110_create_message(int field_size) {
     MT24110_CHECK_NULL(msg->field8, "malloc field8");
 
     /* Fill with simple test pattern - my initials AS */
-    memset(msg->field1, 'A', alloc_size - 1);
-    memset(msg->field2, 'S', alloc_size - 1);
-    memset(msg->field3, 'M', alloc_size - 1);
-    memset(msg->field4, 'T', alloc_size - 1);
-    memset(msg->field5, '2', alloc_size - 1);
-    memset(msg->field6, '4', alloc_size - 1);
-    memset(msg->field7, '1', alloc_size - 1);
-    memset(msg->field8, '0', alloc_size + remainder - 1);
+    mt24110_fill(msg->field1, 'A', alloc_size - 1);
+    mt24110_fill(msg->field2, 'S', alloc_size - 1);
+    mt24110_fill(msg->field3, 'M', alloc_size - 1);
+    mt24110_fill(msg->field4, 'T', alloc_size - 1);
+    mt24110_fill(msg->field5, '2', alloc_size - 1);
+    mt24110_fill(msg->field6, '4', alloc_size - 1);
+    mt24110_fill(msg->field7, '1', alloc_size - 1);
+    mt24110_fill(msg->field8, '0', alloc_size + remainder - 1);
 
     /* Null terminate each field */
     msg->field1[alloc_size - 1] = '\0';
@@ -59,6 +68,12 @@ MT24110_Message *mt24110_create_message(int field_size) {
     msg->field7[alloc_size - 1] = '\0';
     msg->field8[alloc_size + remainder - 1] = '\0';
 
+    /* Lengths are known here, serialize need not scan for them */
+    for (int i = 0; i < 7; i++) {
+        msg->lengths[i] = alloc_size;
+    }
+    msg->lengths[7] = alloc_size + remainder;
+
     return msg;
 }
 
@@ -84,34 +99,27 @@ void mt24110_destroy_message(MT24110_Message *msg) {
  * Buffer layout: field1|field2|field3|field4|field5|field6|field7|field8
  */
 void mt24110_serialize_message(MT24110_Message *msg, char *buffer, int buffer_size) {
+    char *fields[8] = { msg->field1, msg->field2, msg->field3, msg->field4,
+                        msg->field5, msg->field6, msg->field7, msg->field8 };
     int offset = 0;
 
+    /* Large payloads are written with streaming stores */
+    long total = 0;
+    for (int i = 0; i < 8; i++) {
+        total += msg->lengths[i];
+    }
+    int stream = (size_t)total >= mt24110_nt_threshold;
+    const MT24110_MemKernels *kernels = mt24110_kernels_active();
+
     /* Copy each field sequentially into buffer */
-    int len1 = strlen(msg->field1) + 1;
-    int len2 = strlen(msg->field2) + 1;
-    int len3 = strlen(msg->field3) + 1;
-    int len4 = strlen(msg->field4) + 1;
-    int len5 = strlen(msg->field5) + 1;
-    int len6 = strlen(msg->field6) + 1;
-    int len7 = strlen(msg->field7) + 1;
-    int len8 = strlen(msg->field8) + 1;
-
-    memcpy(buffer + offset, msg->field1, len1);
-    offset += len1;
-    memcpy(buffer + offset, msg->field2, len2);
-    offset += len2;
-    memcpy(buffer + offset, msg->field3, len3);
-    offset += len3;
-    memcpy(buffer + offset, msg->field4, len4);
-    offset += len4;
-    memcpy(buffer + offset, msg->field5, len5);
-    offset += len5;
-    memcpy(buffer + offset, msg->field6, len6);
-    offset += len6;
-    memcpy(buffer + offset, msg->field7, len7);
-    offset += len7;
-    memcpy(buffer + offset, msg->field8, len8);
-    offset += len8;
+    for (int i = 0; i < 8; i++) {
+        if (stream) {
+            kernels->copy_nt(buffer + offset, fields[i], msg->lengths[i]);
+        } else {
+            memcpy(buffer + offset, fields[i], msg->lengths[i]);
+        }
+        offset += msg->lengths[i];
+    }
 }
 
 /*
@@ -121,24 +129,19 @@ MT24110_Message *mt24110_deserialize_message(char *buffer, int buffer_size) {
     MT24110_Message *msg = malloc(sizeof(MT24110_Message));
     MT24110_CHECK_NULL(msg, "malloc deserialize");
 
+    char **fields[8] = { &msg->field1, &msg->field2, &msg->field3, &msg->field4,
+                         &msg->field5, &msg->field6, &msg->field7, &msg->field8 };
     int offset = 0;
 
     /* Extract each field from buffer */
-    msg->field1 = strdup(buffer + offset);
-    offset += strlen(msg->field1) + 1;
-    msg->field2 = strdup(buffer + offset);
-    offset += strlen(msg->field2) + 1;
-    msg->field3 = strdup(buffer + offset);
-    offset += strlen(msg->field3) + 1;
-    msg->field4 = strdup(buffer + offset);
-    offset += strlen(msg->field4) + 1;
-    msg->field5 = strdup(buffer + offset);
-    offset += strlen(msg->field5) + 1;
-    msg->field6 = strdup(buffer + offset);
-    offset += strlen(msg->field6) + 1;
-    msg->field7 = strdup(buffer + offset);
-    offset += strlen(msg->field7) + 1;
-    msg->field8 = strdup(buffer + offset);
+    for (int i = 0; i < 8; i++) {
+        int len = strlen(buffer + offset) + 1;
+        *fields[i] = malloc(len);
+        MT24110_CHECK_NULL(*fields[i], "malloc deserialize field");
+        mt24110_copy(*fields[i], buffer + offset, len);
+        msg->lengths[i] = len;
+        offset += len;
+    }
 
     return msg;
 }
@@ -169,8 +172,425 @@ void mt24110_print_stats(MT24110_Stats *stats) {
     printf("Bytes Received: %ld\n", br);
     printf("Messages Sent: %ld\n", ms);
     printf("Messages Received: %ld\n", mr);
-    if (mr > 0) {
+    if (mr > 0 && tl > 0) {
         printf("Avg Latency: %.2f us\n", (double)tl / mr);
     }
 }
 
+
+
+/*
+ * Match a "--name=value" argument, returning a pointer to value or NULL
+ */
+const char *mt24110_option_value(const char *arg, const char *name) {
+    size_t len = strlen(name);
+    if (strncmp(arg, "--", 2) != 0) return NULL;
+    if (strncmp(arg + 2, name, len) != 0) return NULL;
+    if (arg[2 + len] != '=') return NULL;
+    return arg + 3 + len;
+}
+
+/*
+ * Parse optional client arguments following the positional ones.
+ * Returns 0 on success, -1 on an unknown or malformed option.
+ */
+int mt24110_parse_client_options(int argc, char *argv[], int first, MT24110_ClientConfig *config) {
+    config->size_dist = NULL;
+    config->hybrid = NULL;
+    config->specialize = 1;
+    config->compress = NULL;
+    config->compress_min = MT24110_CODEC_DEFAULT_MIN_SIZE;
+    config->payload = NULL;
+    config->coalesce = NULL;
+    config->window = MT24110_COALESCE_DEFAULT_WINDOW;
+    config->rate = 0;
+    config->msg_trace = NULL;
+    config->drain_ms = MT24110_DEFAULT_DRAIN_MS;
+    config->sockopt_profile = NULL;
+    config->sockopt_overrides = NULL;
+    config->telemetry_ms = 0;
+    config->telemetry_out = NULL;
+
+    for (int i = first; i < argc; i++) {
+        const char *value;
+
+        if ((value = mt24110_option_value(argv[i], "size-dist")) != NULL) {
+            config->size_dist = value;
+        } else if ((value = mt24110_option_value(argv[i], "hybrid")) != NULL) {
+            config->hybrid = value;
+        } else if ((value = mt24110_option_value(argv[i], "drain-ms")) != NULL) {
+            config->drain_ms = atoi(value);
+        } else if ((value = mt24110_option_value(argv[i], "sockopt-profile")) != NULL) {
+            config->sockopt_profile = value;
+        } else if ((value = mt24110_option_value(argv[i], "sockopt")) != NULL) {
+            config->sockopt_overrides = value;
+        } else if ((value = mt24110_option_value(argv[i], "telemetry")) != NULL) {
+            config->telemetry_ms = atoi(value);
+        } else if ((value = mt24110_option_value(argv[i], "telemetry-out")) != NULL) {
+            config->telemetry_out = value;
+        } else if ((value = mt24110_option_value(argv[i], "specialize")) != NULL) {
+            config->specialize = atoi(value);
+        } else if ((value = mt24110_option_value(argv[i], "compress")) != NULL) {
+            config->compress = value;
+        } else if ((value = mt24110_option_value(argv[i], "compress-min")) != NULL) {
+            config->compress_min = atoi(value);
+        } else if ((value = mt24110_option_value(argv[i], "payload")) != NULL) {
+            config->payload = value;
+        } else if ((value = mt24110_option_value(argv[i], "coalesce")) != NULL) {
+            config->coalesce = value;
+        } else if ((value = mt24110_option_value(argv[i], "window")) != NULL) {
+            config->window = atoi(value);
+        } else if ((value = mt24110_option_value(argv[i], "rate")) != NULL) {
+            config->rate = atol(value);
+        } else if ((value = mt24110_option_value(argv[i], "msg-trace")) != NULL) {
+            config->msg_trace = value;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Print the optional client arguments understood by all clients
+ */
+void mt24110_print_client_options_usage(void) {
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --size-dist=SPEC   fixed:N | uniform:MIN:MAX | lognormal:MEDIAN:SIGMA[:MIN:MAX]\n");
+    fprintf(stderr, "                     | cdf:FILE | trace:FILE (default: fixed message_size)\n");
+    fprintf(stderr, "  --hybrid=POLICY    zero-copy client only: auto | SENDMSG_MIN:ZEROCOPY_MIN\n");
+    fprintf(stderr, "  --drain-ms=N       wait up to N ms for in-flight echoes on stop (default: %d)\n",
+            MT24110_DEFAULT_DRAIN_MS);
+    fprintf(stderr, "  --sockopt-profile=NAME  default | latency | throughput | bulk\n");
+    fprintf(stderr, "  --sockopt=K=V,...  override sndbuf, rcvbuf, nodelay, quickack, cork,\n");
+    fprintf(stderr, "                     notsent_lowat, pacing_rate\n");
+    fprintf(stderr, "  --telemetry=MS     sample TCP_INFO/SIOCOUTQ/SIOCINQ every MS ms (default: off)\n");
+    fprintf(stderr, "  --telemetry-out=F  write per-interval telemetry rows to CSV file F\n");
+    fprintf(stderr, "  --specialize=0     use the generic loop even for fixed message sizes\n");
+    fprintf(stderr, "  --compress=MODE    off (default), message, or batch:N messages per frame\n");
+    fprintf(stderr, "  --compress-min=N   store frames under N bytes uncompressed (default: %d)\n",
+            MT24110_CODEC_DEFAULT_MIN_SIZE);
+    fprintf(stderr, "  --payload=KIND     with --compress: pattern (default) or random (incompressible)\n");
+    fprintf(stderr, "  --coalesce=POLICY  batch messages per send: size:BYTES | deadline:US | explicit[:N]\n");
+    fprintf(stderr, "  --window=N         messages in flight when coalescing (default: %d)\n",
+            MT24110_COALESCE_DEFAULT_WINDOW);
+    fprintf(stderr, "  --rate=N           messages/s per thread when coalescing (default: unpaced)\n");
+    fprintf(stderr, "  --msg-trace=F      write per-message lifecycle timestamps to binary file F\n");
+}
+
+/*
+ * Parse optional server arguments following the positional ones.
+ * Returns 0 on success, -1 on an unknown or malformed option.
+ */
+int mt24110_parse_server_options(int argc, char *argv[], int first, MT24110_ServerConfig *config) {
+    config->handler = "echo";
+    config->handoff = 0;
+    config->num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    config->drain_ms = MT24110_DEFAULT_DRAIN_MS;
+    config->sockopt_profile = NULL;
+    config->sockopt_overrides = NULL;
+    config->telemetry_ms = 0;
+    config->telemetry_out = NULL;
+    config->prefork = 0;
+    config->reuseport = 0;
+    config->msg_trace = NULL;
+    config->high_water = MT24110_FLOW_DEFAULT_HIGH;
+    config->low_water = MT24110_FLOW_DEFAULT_LOW;
+    config->queue_cap = MT24110_FLOW_DEFAULT_CAP;
+
+    for (int i = first; i < argc; i++) {
+        const char *value;
+
+        if ((value = mt24110_option_value(argv[i], "handler")) != NULL) {
+            config->handler = value;
+        } else if ((value = mt24110_option_value(argv[i], "dispatch")) != NULL) {
+            if (strcmp(value, "inline") == 0) {
+                config->handoff = 0;
+            } else if (strcmp(value, "handoff") == 0) {
+                config->handoff = 1;
+            } else {
+                fprintf(stderr, "Invalid dispatch mode: %s\n", value);
+                return -1;
+            }
+        } else if ((value = mt24110_option_value(argv[i], "workers")) != NULL) {
+            config->num_workers = atoi(value);
+            if (config->num_workers <= 0) {
+                fprintf(stderr, "Invalid worker count: %s\n", value);
+                return -1;
+            }
+        } else if ((value = mt24110_option_value(argv[i], "drain-ms")) != NULL) {
+            config->drain_ms = atoi(value);
+        } else if ((value = mt24110_option_value(argv[i], "sockopt-profile")) != NULL) {
+            config->sockopt_profile = value;
+        } else if ((value = mt24110_option_value(argv[i], "sockopt")) != NULL) {
+            config->sockopt_overrides = value;
+        } else if ((value = mt24110_option_value(argv[i], "telemetry")) != NULL) {
+            config->telemetry_ms = atoi(value);
+        } else if ((value = mt24110_option_value(argv[i], "telemetry-out")) != NULL) {
+            config->telemetry_out = value;
+        } else if ((value = mt24110_option_value(argv[i], "prefork")) != NULL) {
+            config->prefork = atoi(value);
+            if (config->prefork < 0) {
+                fprintf(stderr, "Invalid worker process count: %s\n", value);
+                return -1;
+            }
+        } else if ((value = mt24110_option_value(argv[i], "listener")) != NULL) {
+            if (strcmp(value, "shared") == 0) {
+                config->reuseport = 0;
+            } else if (strcmp(value, "reuseport") == 0) {
+                config->reuseport = 1;
+            } else {
+                fprintf(stderr, "Invalid listener mode: %s\n", value);
+                return -1;
+            }
+        } else if ((value = mt24110_option_value(argv[i], "msg-trace")) != NULL) {
+            config->msg_trace = value;
+        } else if ((value = mt24110_option_value(argv[i], "high-water")) != NULL) {
+            config->high_water = atol(value);
+        } else if ((value = mt24110_option_value(argv[i], "low-water")) != NULL) {
+            config->low_water = atol(value);
+        } else if ((value = mt24110_option_value(argv[i], "queue-cap")) != NULL) {
+            config->queue_cap = atol(value);
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Print the optional server arguments
+ */
+void mt24110_print_server_options_usage(void) {
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --handler=NAME     echo | checksum | transform (default: echo)\n");
+    fprintf(stderr, "  --dispatch=MODE    inline (run-to-completion, default) | handoff (worker pool)\n");
+    fprintf(stderr, "  --workers=N        worker pool size for handoff (default: online CPUs)\n");
+    fprintf(stderr, "  --drain-ms=N       keep serving in-flight messages up to N ms on stop (default: %d)\n",
+            MT24110_DEFAULT_DRAIN_MS);
+    fprintf(stderr, "  --sockopt-profile=NAME  default | latency | throughput | bulk\n");
+    fprintf(stderr, "  --sockopt=K=V,...  override sndbuf, rcvbuf, nodelay, quickack, cork,\n");
+    fprintf(stderr, "                     notsent_lowat, pacing_rate\n");
+    fprintf(stderr, "  --telemetry=MS     sample TCP_INFO/SIOCOUTQ/SIOCINQ every MS ms (default: off)\n");
+    fprintf(stderr, "  --telemetry-out=F  write per-interval telemetry rows to CSV file F\n");
+    fprintf(stderr, "  --prefork=N        N worker processes with epoll loops instead of threads\n");
+    fprintf(stderr, "  --listener=MODE    prefork only: shared (inherited, default) | reuseport\n");
+    fprintf(stderr, "  --msg-trace=F      write per-chunk receive/send timestamps to binary file F\n");
+    fprintf(stderr, "  --high-water=N     stop reading a connection with N echo bytes queued (default: %d)\n",
+            MT24110_FLOW_DEFAULT_HIGH);
+    fprintf(stderr, "  --low-water=N      resume reading at N queued bytes or fewer (default: %d)\n",
+            MT24110_FLOW_DEFAULT_LOW);
+    fprintf(stderr, "  --queue-cap=N      queued echo bytes allowed per process (default: %ld)\n",
+            MT24110_FLOW_DEFAULT_CAP);
+}
+
+/*
+ * Sleep until base + offset_us on CLOCK_MONOTONIC (used for trace pacing)
+ */
+void mt24110_sleep_until(const struct timespec *base, long offset_us) {
+    struct timespec target = *base;
+    target.tv_sec += offset_us / 1000000L;
+    target.tv_nsec += (offset_us % 1000000L) * 1000L;
+    if (target.tv_nsec >= 1000000000L) {
+        target.tv_sec++;
+        target.tv_nsec -= 1000000000L;
+    }
+
+    /* Sleep on the shutdown eventfd so a stop request cuts the wait short */
+    while (!mt24110_shutdown_requested()) {
+        struct timespec now, rel;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        rel.tv_sec = target.tv_sec - now.tv_sec;
+        rel.tv_nsec = target.tv_nsec - now.tv_nsec;
+        if (rel.tv_nsec < 0) {
+            rel.tv_sec--;
+            rel.tv_nsec += 1000000000L;
+        }
+        if (rel.tv_sec < 0) break;
+
+        struct pollfd pfd = { .fd = shutdown_efd, .events = POLLIN, .revents = 0 };
+        if (ppoll(&pfd, 1, &rel, NULL) == 0) break;
+    }
+}
+
+static long long mt24110_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Create the shutdown eventfd. Must run before any thread starts.
+ * SIGPIPE is ignored so a peer closing during drain surfaces as EPIPE.
+ */
+void mt24110_shutdown_init(int drain_ms) {
+    /* A forked child re-initializes and must not share the parent's eventfd */
+    if (shutdown_efd >= 0) close(shutdown_efd);
+    shutdown_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (shutdown_efd < 0) {
+        perror("eventfd failed");
+        exit(EXIT_FAILURE);
+    }
+    shutdown_drain_ms = drain_ms;
+    atomic_store(&shutdown_flag, 0);
+    atomic_store(&shutdown_deadline_ns, 0);
+    signal(SIGPIPE, SIG_IGN);
+}
+
+/*
+ * Install handler for SIGINT/SIGTERM without SA_RESTART, so blocking
+ * calls return EINTR instead of silently resuming
+ */
+void mt24110_install_signal_handler(void (*handler)(int)) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+
+/*
+ * Request shutdown and start the drain clock. Async-signal-safe.
+ * The eventfd is never read, so it stays readable and wakes every poller.
+ */
+void mt24110_shutdown_trigger(void) {
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&shutdown_flag, &expected, 1)) return;
+
+    atomic_store(&shutdown_deadline_ns, mt24110_now_ns() + shutdown_drain_ms * 1000000LL);
+    uint64_t one = 1;
+    ssize_t w = write(shutdown_efd, &one, sizeof(one));
+    (void)w;
+}
+
+int mt24110_shutdown_requested(void) {
+    return atomic_load(&shutdown_flag);
+}
+
+/*
+ * The shutdown eventfd, for loops that wait in epoll rather than
+ * through mt24110_wait_fd. It becomes readable on shutdown and stays so.
+ */
+int mt24110_shutdown_fd(void) {
+    return shutdown_efd;
+}
+
+/*
+ * Milliseconds left until the drain deadline, rounded up: -1 while no
+ * shutdown is requested, 0 once the deadline has passed
+ */
+int mt24110_drain_remaining_ms(void) {
+    if (!mt24110_shutdown_requested()) return -1;
+
+    long long deadline = atomic_load(&shutdown_deadline_ns);
+    if (deadline == 0) return shutdown_drain_ms;    /* trigger still running */
+
+    long long remaining = deadline - mt24110_now_ns();
+    return (remaining > 0) ? (int)((remaining + 999999) / 1000000) : 0;
+}
+
+/*
+ * Wait up to timeout_ms for a shutdown request (used for the run duration).
+ * Returns 1 if shutdown was requested.
+ */
+int mt24110_wait_shutdown(int timeout_ms) {
+    long long deadline = mt24110_now_ns() + timeout_ms * 1000000LL;
+
+    while (!mt24110_shutdown_requested()) {
+        long long remaining = deadline - mt24110_now_ns();
+        if (remaining <= 0) return 0;
+
+        struct pollfd pfd = { .fd = shutdown_efd, .events = POLLIN, .revents = 0 };
+        poll(&pfd, 1, (int)((remaining + 999999) / 1000000));
+    }
+    return 1;
+}
+
+/*
+ * Join tid, waiting at most until the drain deadline of a requested
+ * shutdown. Returns 0 once joined, -1 if the thread is still running.
+ */
+int mt24110_join_drain(pthread_t tid) {
+    long long remaining = atomic_load(&shutdown_deadline_ns) - mt24110_now_ns();
+    if (remaining < 0) remaining = 0;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += remaining / 1000000000LL;
+    deadline.tv_nsec += remaining % 1000000000LL;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return pthread_timedjoin_np(tid, NULL, &deadline) == 0 ? 0 : -1;
+}
+
+/*
+ * Block until fd is ready for events or shutdown is requested.
+ * With drain set, a shutdown does not end the wait immediately: fd is
+ * still served until the drain deadline passes.
+ * Returns 1 when fd is ready, 0 on shutdown / drain expiry, -1 on error.
+ */
+int mt24110_wait_fd(int fd, short events, int drain) {
+    return mt24110_wait_fd_timeout(fd, events, drain, -1);
+}
+
+/*
+ * mt24110_wait_fd with a microsecond timer (timeout_us < 0: none).
+ * Returns MT24110_WAIT_TIMEOUT when the timer fires first.
+ */
+int mt24110_wait_fd_timeout(int fd, short events, int drain, long timeout_us) {
+    struct pollfd pfd = { .fd = fd, .events = events, .revents = 0 };
+    return mt24110_wait_fds(&pfd, 1, drain, timeout_us);
+}
+
+/*
+ * Wait on up to MT24110_WAIT_MAX_FDS descriptors at once, with the same
+ * shutdown, drain and timer rules as mt24110_wait_fd_timeout. Returns 1
+ * when any fd is ready (check fds[i].revents).
+ */
+int mt24110_wait_fds(struct pollfd *fds, int nfds, int drain, long timeout_us) {
+    struct pollfd pfd[MT24110_WAIT_MAX_FDS + 1];
+    long long timer_ns = (timeout_us >= 0) ? mt24110_now_ns() + timeout_us * 1000LL : -1;
+
+    memcpy(pfd, fds, nfds * sizeof(struct pollfd));
+    pfd[nfds].fd = shutdown_efd;
+    pfd[nfds].events = POLLIN;
+
+    for (;;) {
+        int watched = nfds + 1;
+        long long now = mt24110_now_ns();
+        long long wait_ns = -1;
+
+        if (mt24110_shutdown_requested()) {
+            if (!drain) return 0;
+            long long remaining = atomic_load(&shutdown_deadline_ns) - now;
+            watched = nfds;
+            wait_ns = (remaining > 0) ? remaining : 0;
+        }
+        if (timer_ns >= 0) {
+            long long remaining = (timer_ns > now) ? timer_ns - now : 0;
+            if (wait_ns < 0 || remaining < wait_ns) wait_ns = remaining;
+        }
+
+        struct timespec ts = { .tv_sec = wait_ns / 1000000000LL, .tv_nsec = wait_ns % 1000000000LL };
+        int ready = ppoll(pfd, watched, (wait_ns >= 0) ? &ts : NULL, NULL);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        int any = 0;
+        for (int i = 0; i < nfds; i++) {
+            fds[i].revents = pfd[i].revents;
+            any |= (pfd[i].revents != 0);
+        }
+        if (any) return 1;
+        if (ready == 0) {
+            if (timer_ns >= 0 && mt24110_now_ns() >= timer_ns) return MT24110_WAIT_TIMEOUT;
+            if (watched == nfds) return 0;   /* drain deadline passed */
+        }
+    }
+}
@@ -22,6 +22,7 @@
 #include <time.h>
 #include <signal.h>
 #include <stdatomic.h>
+#include <poll.h>
 
 /* Message structure with 8 dynamically allocated string fields */
 typedef struct {
@@ -33,6 +34,7 @@ typedef struct {
     char *field6;
     char *field7;
     char *field8;
+    int lengths[8];             /* bytes per field incl. terminator */
 } MT24110_Message;
 
 /* Server configuration */
@@ -41,6 +43,20 @@ typedef struct {
     int message_size;
     int num_threads;
     volatile int running;
+    const char *handler;        /* --handler: per-message processing stage */
+    int handoff;                /* --dispatch=handoff: run handler on worker pool */
+    int num_workers;            /* --workers: worker pool size */
+    int drain_ms;               /* --drain-ms: bound on shutdown draining */
+    const char *sockopt_profile;    /* --sockopt-profile: named TCP tuning */
+    const char *sockopt_overrides;  /* --sockopt: key=value,... on top */
+    int telemetry_ms;           /* --telemetry: TCP_INFO sampling interval, 0 = off */
+    const char *telemetry_out;  /* --telemetry-out: per-interval CSV file */
+    int prefork;                /* --prefork: worker processes, 0 = threads */
+    int reuseport;              /* --listener=reuseport: listener per worker */
+    const char *msg_trace;      /* --msg-trace: per-message timestamp file */
+    long high_water;            /* --high-water: stop reading a connection above */
+    long low_water;             /* --low-water: resume reading at or below */
+    long queue_cap;             /* --queue-cap: queued echo bytes per process */
 } MT24110_ServerConfig;
 
 /* Client configuration */
@@ -51,6 +67,21 @@ typedef struct {
     int num_threads;
     int duration_sec;
     volatile int running;
+    const char *size_dist;      /* --size-dist spec, NULL for fixed size */
+    const char *hybrid;         /* --hybrid copy policy (zero-copy client only) */
+    int drain_ms;               /* --drain-ms: wait for in-flight echoes on stop */
+    const char *sockopt_profile;    /* --sockopt-profile: named TCP tuning */
+    const char *sockopt_overrides;  /* --sockopt: key=value,... on top */
+    int telemetry_ms;           /* --telemetry: TCP_INFO sampling interval, 0 = off */
+    const char *telemetry_out;  /* --telemetry-out: per-interval CSV file */
+    int specialize;             /* --specialize=0 forces the generic loop */
+    const char *compress;       /* --compress: off, message or batch:N */
+    int compress_min;           /* --compress-min: smallest frame worth compressing */
+    const char *payload;        /* --payload: pattern or random */
+    const char *coalesce;       /* --coalesce: off, size:N, deadline:US or explicit[:N] */
+    int window;                 /* --window: messages in flight when coalescing */
+    long rate;                  /* --rate: messages/s per thread, 0 = unpaced */
+    const char *msg_trace;      /* --msg-trace: per-message timestamp file */
 } MT24110_ClientConfig;
 
 /* Statistics structure */
@@ -69,6 +100,31 @@ void mt24110_serialize_message(MT24110_Message *msg, char *buffer, int buffer_si
 MT24110_Message *mt24110_deserialize_message(char *buffer, int buffer_size);
 void mt24110_init_stats(MT24110_Stats *stats);
 void mt24110_print_stats(MT24110_Stats *stats);
+const char *mt24110_option_value(const char *arg, const char *name);
+int mt24110_parse_client_options(int argc, char *argv[], int first, MT24110_ClientConfig *config);
+void mt24110_print_client_options_usage(void);
+int mt24110_parse_server_options(int argc, char *argv[], int first, MT24110_ServerConfig *config);
+void mt24110_print_server_options_usage(void);
+void mt24110_sleep_until(const struct timespec *base, long offset_us);
+
+/*
+ * Coordinated shutdown: one eventfd wakes every thread blocked in poll().
+ * Threads blocked in recv() are left alone; their owner joins them with
+ * mt24110_join_drain() and shuts their socket down once --drain-ms ends.
+ */
+void mt24110_shutdown_init(int drain_ms);
+void mt24110_install_signal_handler(void (*handler)(int));
+void mt24110_shutdown_trigger(void);
+int mt24110_shutdown_requested(void);
+int mt24110_wait_shutdown(int timeout_ms);
+int mt24110_join_drain(pthread_t tid);
+int mt24110_wait_fd(int fd, short events, int drain);
+int mt24110_wait_fd_timeout(int fd, short events, int drain, long timeout_us);
+int mt24110_wait_fds(struct pollfd *fds, int nfds, int drain, long timeout_us);
+int mt24110_shutdown_fd(void);
+int mt24110_drain_remaining_ms(void);
+#define MT24110_WAIT_TIMEOUT 2
+#define MT24110_WAIT_MAX_FDS 4
 
 /* Utility macros */
 #define MT24110_CHECK_NULL(ptr, msg) if ((ptr) == NULL) { perror(msg); exit(EXIT_FAILURE); }
@@ -79,6 +135,18 @@ void mt24110_print_stats(MT24110_Stats *stats);
 #define MT24110_DEFAULT_MESSAGE_SIZE 1024
 #define MT24110_DEFAULT_NUM_THREADS 4
 #define MT24110_DEFAULT_DURATION 5
+#define MT24110_DEFAULT_DRAIN_MS 1000
+
+/* Frames below this many raw bytes are stored, not compressed (--compress-min) */
+#define MT24110_CODEC_DEFAULT_MIN_SIZE 256
+
+/* Messages in flight per coalescing thread (--window) */
+#define MT24110_COALESCE_DEFAULT_WINDOW 32
+
+/* Echo output queue watermarks and cap (--high-water/--low-water/--queue-cap) */
+#define MT24110_FLOW_DEFAULT_HIGH (256 * 1024)
+#define MT24110_FLOW_DEFAULT_LOW (64 * 1024)
+#define MT24110_FLOW_DEFAULT_CAP (64L * 1024 * 1024)
 
 #endif /* MT24110_COMMON_H */
 
@@ -0,0 +1,240 @@
+/*
+ * MT24110_Flow.c
+ * Per-connection output queues with watermark backpressure
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_Flow.h"
+
+/* Queue buffers up to this size are kept when the queue empties */
+#define MT24110_FLOW_KEEP_BYTES (64 * 1024)
+#define MT24110_FLOW_MIN_ALLOC 4096
+
+/* Bytes queued by every connection of this process */
+static atomic_long total_queued;
+static atomic_long peak_queued;
+
+static long long mt24110_flow_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Validate the watermarks. Returns 0 on success, -1 with a message
+ * when they cannot work together.
+ */
+int mt24110_flow_config_init(long high_water, long low_water, long queue_cap, MT24110_FlowConfig *cfg) {
+    if (high_water <= 0 || low_water < 0 || low_water > high_water) {
+        fprintf(stderr, "Invalid watermarks: need 0 <= low-water (%ld) <= high-water (%ld)\n",
+                low_water, high_water);
+        return -1;
+    }
+    if (queue_cap < high_water) {
+        fprintf(stderr, "Invalid queue cap %ld: must be at least high-water (%ld)\n",
+                queue_cap, high_water);
+        return -1;
+    }
+    cfg->high_water = high_water;
+    cfg->low_water = low_water;
+    cfg->queue_cap = queue_cap;
+    return 0;
+}
+
+void mt24110_outq_init(MT24110_OutQueue *q) {
+    memset(q, 0, sizeof(*q));
+}
+
+/*
+ * Drop whatever is still queued (the connection is closing) and record
+ * the final counters. Read q->counters only after this.
+ */
+void mt24110_outq_free(MT24110_OutQueue *q) {
+    atomic_fetch_sub(&total_queued, q->len);
+    if (q->throttled) {
+        q->counters.throttled_ns += mt24110_flow_now_ns() - q->throttled_at_ns;
+        q->throttled = 0;
+    }
+    long peak = atomic_load(&peak_queued);
+    if (peak > q->counters.peak_total) q->counters.peak_total = peak;
+
+    free(q->data);
+    q->data = NULL;
+    q->off = q->len = q->capacity = 0;
+    q->held = NULL;
+    q->held_len = 0;
+}
+
+/*
+ * Copy n bytes behind the backlog if the process stays within the cap.
+ * Returns 0, or -1 when the cap refused them.
+ */
+static int mt24110_outq_append(MT24110_OutQueue *q, const char *data, long n,
+                               const MT24110_FlowConfig *cfg) {
+    long total = atomic_load(&total_queued);
+    do {
+        if (total + n > cfg->queue_cap) return -1;
+    } while (!atomic_compare_exchange_weak(&total_queued, &total, total + n));
+    total += n;
+
+    if (q->off + q->len + n > q->capacity) {
+        if (q->off > 0) {
+            memmove(q->data, q->data + q->off, q->len);
+            q->off = 0;
+        }
+        if (q->len + n > q->capacity) {
+            long capacity = q->capacity ? q->capacity * 2 : MT24110_FLOW_MIN_ALLOC;
+            while (capacity < q->len + n) capacity *= 2;
+            q->data = realloc(q->data, capacity);
+            MT24110_CHECK_NULL(q->data, "realloc output queue");
+            q->capacity = capacity;
+        }
+    }
+    memcpy(q->data + q->off + q->len, data, n);
+    q->len += n;
+    q->counters.deferred_bytes += n;
+    if (q->len > q->counters.peak_queue) q->counters.peak_queue = q->len;
+
+    if (total > q->counters.peak_total) q->counters.peak_total = total;
+    long peak = atomic_load(&peak_queued);
+    while (total > peak && !atomic_compare_exchange_weak(&peak_queued, &peak, total)) {
+    }
+    return 0;
+}
+
+/*
+ * May the connection read another chunk? Not while throttled at the
+ * high watermark, and not while the last echo is held in the caller's
+ * buffer, which the next chunk would overwrite.
+ */
+int mt24110_outq_can_read(const MT24110_OutQueue *q) {
+    return !q->throttled && q->held_len == 0;
+}
+
+/*
+ * Send len bytes without blocking; the part the socket does not take
+ * now is queued behind any earlier backlog. When the cap refuses that
+ * part, q keeps pointing into data: leave data untouched and send
+ * nothing else until mt24110_outq_holding() is false. Returns the bytes
+ * written immediately, or -1 with errno set when the connection failed.
+ */
+int mt24110_outq_send(MT24110_OutQueue *q, int fd, const char *data, int len, const MT24110_FlowConfig *cfg) {
+    int sent = 0;
+
+    /* Bytes may only bypass the queue when it is empty */
+    while (q->len == 0 && sent < len) {
+        int n = send(fd, data + sent, len - sent, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        sent += n;
+    }
+
+    if (sent < len) {
+        if (mt24110_outq_append(q, data + sent, len - sent, cfg) < 0) {
+            q->held = data + sent;
+            q->held_len = len - sent;
+            q->counters.cap_stalls++;
+        } else if (!q->throttled && q->len >= cfg->high_water) {
+            q->throttled = 1;
+            q->throttled_at_ns = mt24110_flow_now_ns();
+            q->counters.throttles++;
+        }
+    }
+    return sent;
+}
+
+/*
+ * Write queued bytes, then held ones, until the socket is full. Resumes
+ * reading once the queue is at or below the low watermark and nothing
+ * is held. Returns the bytes written, or -1 with errno set when the
+ * connection failed.
+ */
+int mt24110_outq_flush(MT24110_OutQueue *q, int fd, const MT24110_FlowConfig *cfg) {
+    int flushed = 0;
+
+    while (q->len > 0) {
+        int n = send(fd, q->data + q->off, q->len, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        q->off += n;
+        q->len -= n;
+        flushed += n;
+    }
+    atomic_fetch_sub(&total_queued, flushed);
+
+    if (q->len == 0) {
+        q->off = 0;
+        if (q->capacity > MT24110_FLOW_KEEP_BYTES) {
+            free(q->data);
+            q->data = NULL;
+            q->capacity = 0;
+        }
+    }
+
+    /* The held remainder was sent after everything queued before it */
+    while (q->len == 0 && q->held_len > 0) {
+        int n = send(fd, q->held, q->held_len, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        q->held += n;
+        q->held_len -= n;
+        flushed += n;
+    }
+    if (q->held_len == 0) q->held = NULL;
+    if (q->throttled && q->len <= cfg->low_water) {
+        q->throttled = 0;
+        q->counters.throttled_ns += mt24110_flow_now_ns() - q->throttled_at_ns;
+    }
+    return flushed;
+}
+
+void mt24110_flow_counters_add(MT24110_FlowCounters *total, const MT24110_FlowCounters *c) {
+    total->throttles += c->throttles;
+    total->cap_stalls += c->cap_stalls;
+    total->deferred_bytes += c->deferred_bytes;
+    total->throttled_ns += c->throttled_ns;
+    if (c->peak_queue > total->peak_queue) total->peak_queue = c->peak_queue;
+    if (c->peak_total > total->peak_total) total->peak_total = c->peak_total;
+}
+
+/*
+ * Add what c gained since the last call to total, so a running
+ * connection's counters can be folded in as they grow. published holds
+ * the part of c already in total (zeroed when c was).
+ */
+void mt24110_flow_counters_publish(MT24110_FlowCounters *total, const MT24110_FlowCounters *c,
+                                   MT24110_FlowCounters *published) {
+    total->throttles += c->throttles - published->throttles;
+    total->cap_stalls += c->cap_stalls - published->cap_stalls;
+    total->deferred_bytes += c->deferred_bytes - published->deferred_bytes;
+    total->throttled_ns += c->throttled_ns - published->throttled_ns;
+    if (c->peak_queue > total->peak_queue) total->peak_queue = c->peak_queue;
+    if (c->peak_total > total->peak_total) total->peak_total = c->peak_total;
+    *published = *c;
+}
+
+/*
+ * Print the backpressure summary
+ */
+void mt24110_flow_print(const MT24110_FlowCounters *c, const MT24110_FlowConfig *cfg) {
+    printf("\n=== Flow Control ===\n");
+    printf("Watermarks: high %ld B, low %ld B, cap %ld B queued per process\n",
+           cfg->high_water, cfg->low_water, cfg->queue_cap);
+    printf("Throttled at high watermark: %ld times, %.2f ms total\n",
+           c->throttles, c->throttled_ns / 1e6);
+    printf("Held in the receive buffer at the queue cap: %ld times\n", c->cap_stalls);
+    printf("Queued echo bytes: %ld (peak %ld B per connection, %ld B per process)\n",
+           c->deferred_bytes, c->peak_queue, c->peak_total);
+}
@@ -0,0 +1,75 @@
+/*
+ * MT24110_Flow.h
+ * Per-connection output queues with watermark backpressure
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * Echoes are written with MSG_DONTWAIT; whatever the socket does not
+ * take is appended to the connection's output queue and flushed on
+ * POLLOUT, so a client that stops reading never blocks its thread.
+ * The queue also throttles input:
+ *   queued >= --high-water   stop reading from this connection
+ *   queued <= --low-water    resume reading
+ * --queue-cap is a hard limit on the bytes copied into the queues of one
+ * process (of each worker in pre-fork mode). An unsent remainder that
+ * would cross it is not copied: the queue keeps pointing into the
+ * caller's buffer and the connection stops reading until those bytes
+ * have been written from there.
+ */
+
+#ifndef MT24110_FLOW_H
+#define MT24110_FLOW_H
+
+typedef struct {
+    long high_water;
+    long low_water;
+    long queue_cap;
+} MT24110_FlowConfig;
+
+/* Throttling counters, per connection and summed over connections */
+typedef struct {
+    long throttles;             /* reading paused at the high watermark */
+    long cap_stalls;            /* echoes held in the caller's buffer at the cap */
+    long deferred_bytes;        /* echo bytes that had to be queued */
+    long long throttled_ns;     /* time spent above the high watermark */
+    long peak_queue;            /* deepest single connection queue */
+    long peak_total;            /* most bytes queued in one process */
+} MT24110_FlowCounters;
+
+/* Pending output of one connection */
+typedef struct {
+    char *data;
+    long off;
+    long len;
+    long capacity;
+    int throttled;              /* above high watermark, not yet below low */
+    long long throttled_at_ns;
+    const char *held;           /* remainder the cap kept out of data, or NULL */
+    long held_len;
+    MT24110_FlowCounters counters;
+} MT24110_OutQueue;
+
+/* Function prototypes */
+int mt24110_flow_config_init(long high_water, long low_water, long queue_cap, MT24110_FlowConfig *cfg);
+void mt24110_outq_init(MT24110_OutQueue *q);
+void mt24110_outq_free(MT24110_OutQueue *q);
+int mt24110_outq_can_read(const MT24110_OutQueue *q);
+int mt24110_outq_send(MT24110_OutQueue *q, int fd, const char *data, int len, const MT24110_FlowConfig *cfg);
+int mt24110_outq_flush(MT24110_OutQueue *q, int fd, const MT24110_FlowConfig *cfg);
+void mt24110_flow_counters_add(MT24110_FlowCounters *total, const MT24110_FlowCounters *c);
+void mt24110_flow_counters_publish(MT24110_FlowCounters *total, const MT24110_FlowCounters *c,
+                                   MT24110_FlowCounters *published);
+void mt24110_flow_print(const MT24110_FlowCounters *c, const MT24110_FlowConfig *cfg);
+
+/* Bytes waiting for the socket, queued or held */
+static inline long mt24110_outq_pending(const MT24110_OutQueue *q) {
+    return q->len + q->held_len;
+}
+
+/* Is the last send still parked in the caller's buffer? */
+static inline int mt24110_outq_holding(const MT24110_OutQueue *q) {
+    return q->held_len > 0;
+}
+
+#endif /* MT24110_FLOW_H */
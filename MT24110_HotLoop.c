@@ -0,0 +1,198 @@
+/*
+ * MT24110_HotLoop.c
+ * Send/receive round-trip loops specialized for common message sizes
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_HotLoop.h"
+
+/* How long a zero-copy send waits for completions when optmem is exhausted */
+#define MT24110_HOT_ZC_REAP_TIMEOUT_MS 100
+
+/*
+ * Send exactly len bytes, looping on a short send like the generic
+ * path. MSG_ZEROCOPY counts one pending completion per call and, when
+ * optmem is exhausted, reaps completions before retrying.
+ * Returns 0 on success or the errno to report.
+ */
+static inline __attribute__((always_inline))
+int mt24110_hot_send(int fd, char *buffer, const int len, const MT24110_SendPath path,
+                     struct msghdr *send_hdr, struct iovec *send_iov, MT24110_PathCounters *paths) {
+    const int flags = (path == MT24110_PATH_ZEROCOPY) ? MSG_ZEROCOPY : 0;
+    int sent = 0;
+
+    while (sent < len) {
+        int r;
+        if (path == MT24110_PATH_SEND) {
+            r = send(fd, buffer + sent, len - sent, 0);
+        } else {
+            send_iov->iov_base = buffer + sent;
+            send_iov->iov_len = len - sent;
+            r = sendmsg(fd, send_hdr, flags);
+        }
+
+        if (r > 0) {
+            sent += r;
+            if (path == MT24110_PATH_ZEROCOPY) paths->zc_pending++;
+            continue;
+        }
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && path == MT24110_PATH_ZEROCOPY && errno == ENOBUFS) {
+            mt24110_reap_zerocopy(fd, paths, MT24110_HOT_ZC_REAP_TIMEOUT_MS);
+            continue;
+        }
+        return (r < 0) ? errno : EIO;
+    }
+    return 0;
+}
+
+/*
+ * Receive exactly len bytes with a plain blocking recv()/recvmsg().
+ * On shutdown main cuts a stalled drain off with shutdown(), which
+ * shows up here as end of stream and is reported as ETIMEDOUT.
+ * Returns 0 on success or the errno to report.
+ */
+static inline __attribute__((always_inline))
+int mt24110_hot_recv(int fd, char *buffer, const int len, const MT24110_SendPath path,
+                     struct msghdr *recv_hdr, struct iovec *recv_iov) {
+    int received = 0;
+
+    while (received < len) {
+        int r;
+        if (path == MT24110_PATH_SEND) {
+            r = recv(fd, buffer + received, len - received, 0);
+        } else {
+            recv_iov->iov_base = buffer + received;
+            recv_iov->iov_len = len - received;
+            r = recvmsg(fd, recv_hdr, 0);
+        }
+
+        if (r > 0) {
+            received += r;
+            continue;
+        }
+        if (r == 0) return mt24110_shutdown_requested() ? ETIMEDOUT : ECONNRESET;
+        if (errno == EINTR) continue;
+        return errno;
+    }
+    return 0;
+}
+
+/*
+ * The loop body. Always inlined into each variant: with size and path
+ * known at compile time the path branches fold away and the length is an
+ * immediate; the msghdrs are built once outside the loop.
+ */
+static inline __attribute__((always_inline))
+void mt24110_hot_loop_body(MT24110_HotLoopArgs *a, const int size, const MT24110_SendPath path) {
+    const int fd = a->fd;
+    char *send_buffer = a->send_buffer;
+    char *recv_buffer = a->recv_buffer;
+
+    struct iovec send_iov;
+    struct msghdr send_hdr;
+    memset(&send_hdr, 0, sizeof(send_hdr));
+    send_hdr.msg_iov = &send_iov;
+    send_hdr.msg_iovlen = 1;
+
+    struct iovec recv_iov;
+    struct msghdr recv_hdr;
+    memset(&recv_hdr, 0, sizeof(recv_hdr));
+    recv_hdr.msg_iov = &recv_iov;
+    recv_hdr.msg_iovlen = 1;
+
+    long messages = 0, latency_us = 0;
+    struct timespec start, end;
+
+    while (*a->running && (a->max_messages == 0 || messages < a->max_messages)) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        int err = mt24110_hot_send(fd, send_buffer, size, path, &send_hdr, &send_iov, &a->paths);
+        if (err != 0) {
+            a->error = err;
+            break;
+        }
+
+        err = mt24110_hot_recv(fd, recv_buffer, size, path, &recv_hdr, &recv_iov);
+        if (err != 0) {
+            a->error = err;
+            a->in_flight = 1;
+            break;
+        }
+        if (path == MT24110_PATH_ZEROCOPY) {
+            mt24110_reap_zerocopy(fd, &a->paths, 0);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        latency_us += (end.tv_sec - start.tv_sec) * 1000000L +
+                      (end.tv_nsec - start.tv_nsec) / 1000L;
+        messages++;
+    }
+
+    a->messages += messages;
+    a->bytes_sent += (long)messages * size;
+    a->bytes_received += (long)messages * size;
+    a->total_latency_us += latency_us;
+    a->paths.messages[path] += messages;
+    a->paths.bytes[path] += (long)messages * size;
+}
+
+/*
+ * Generic fallback: same body, size and path read at run time
+ */
+__attribute__((noinline))
+void mt24110_hot_loop_generic(MT24110_HotLoopArgs *args) {
+    mt24110_hot_loop_body(args, args->size, args->path);
+}
+
+/* Generate one specialized variant per (path, size) */
+#define MT24110_HOT_LOOP_VARIANT(tag, path, size) \
+    static void mt24110_hot_loop_##tag##_##size(MT24110_HotLoopArgs *args) { \
+        mt24110_hot_loop_body(args, size, path); \
+    }
+
+#define MT24110_HOT_LOOP_SIZES(tag, path) \
+    MT24110_HOT_LOOP_VARIANT(tag, path, 64) \
+    MT24110_HOT_LOOP_VARIANT(tag, path, 1024) \
+    MT24110_HOT_LOOP_VARIANT(tag, path, 4096) \
+    MT24110_HOT_LOOP_VARIANT(tag, path, 65536)
+
+MT24110_HOT_LOOP_SIZES(send, MT24110_PATH_SEND)
+MT24110_HOT_LOOP_SIZES(sendmsg, MT24110_PATH_SENDMSG)
+MT24110_HOT_LOOP_SIZES(zerocopy, MT24110_PATH_ZEROCOPY)
+
+#define MT24110_HOT_LOOP_NUM_SIZES 4
+
+static const int mt24110_hot_loop_sizes[MT24110_HOT_LOOP_NUM_SIZES] = { 64, 1024, 4096, 65536 };
+
+static const MT24110_HotLoopFn mt24110_hot_loop_table[MT24110_PATH_COUNT][MT24110_HOT_LOOP_NUM_SIZES] = {
+    [MT24110_PATH_SEND] = {
+        mt24110_hot_loop_send_64, mt24110_hot_loop_send_1024,
+        mt24110_hot_loop_send_4096, mt24110_hot_loop_send_65536 },
+    [MT24110_PATH_SENDMSG] = {
+        mt24110_hot_loop_sendmsg_64, mt24110_hot_loop_sendmsg_1024,
+        mt24110_hot_loop_sendmsg_4096, mt24110_hot_loop_sendmsg_65536 },
+    [MT24110_PATH_ZEROCOPY] = {
+        mt24110_hot_loop_zerocopy_64, mt24110_hot_loop_zerocopy_1024,
+        mt24110_hot_loop_zerocopy_4096, mt24110_hot_loop_zerocopy_65536 },
+};
+
+/*
+ * Pick the loop for a fixed-size workload: a specialized variant when
+ * one exists for this size, the generic one otherwise
+ */
+MT24110_HotLoopFn mt24110_hot_loop_select(MT24110_SendPath path, int size) {
+    for (int i = 0; i < MT24110_HOT_LOOP_NUM_SIZES; i++) {
+        if (mt24110_hot_loop_sizes[i] == size) {
+            return mt24110_hot_loop_table[path][i];
+        }
+    }
+    return mt24110_hot_loop_generic;
+}
+
+int mt24110_hot_loop_is_specialized(MT24110_HotLoopFn fn) {
+    return fn != mt24110_hot_loop_generic;
+}
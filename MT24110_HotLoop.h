@@ -0,0 +1,47 @@
+/*
+ * MT24110_HotLoop.h
+ * Send/receive round-trip loops specialized for common message sizes
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * For a fixed-size workload the worker loop is picked once at startup
+ * from a dispatch table indexed by copy path and size. Each entry is the
+ * same loop body compiled with the size and path as constants, so the
+ * msghdrs are set up once and no size or path branch is left in the
+ * loop. Sizes without an entry use the generic variant.
+ */
+
+#ifndef MT24110_HOTLOOP_H
+#define MT24110_HOTLOOP_H
+
+#include "MT24110_Transport.h"
+
+typedef struct {
+    /* Inputs */
+    int fd;
+    char *send_buffer;
+    char *recv_buffer;
+    int size;                   /* used by the generic variant only */
+    MT24110_SendPath path;      /* used by the generic variant only */
+    volatile int *running;
+    long max_messages;          /* per call, 0 = until *running clears */
+
+    /* Outputs */
+    long messages;
+    long bytes_sent;
+    long bytes_received;
+    long total_latency_us;
+    int error;                  /* errno of the failing call, 0 if none */
+    int in_flight;              /* stopped while waiting for an echo */
+    MT24110_PathCounters paths;
+} MT24110_HotLoopArgs;
+
+typedef void (*MT24110_HotLoopFn)(MT24110_HotLoopArgs *args);
+
+/* Function prototypes */
+MT24110_HotLoopFn mt24110_hot_loop_select(MT24110_SendPath path, int size);
+void mt24110_hot_loop_generic(MT24110_HotLoopArgs *args);
+int mt24110_hot_loop_is_specialized(MT24110_HotLoopFn fn);
+
+#endif /* MT24110_HOTLOOP_H */
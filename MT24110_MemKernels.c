@@ -0,0 +1,285 @@
+/*
+ * MT24110_MemKernels.c
+ * CPUID-dispatched fill and copy kernels for payload generation
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_MemKernels.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MT24110_HAVE_X86 1
+#endif
+
+size_t mt24110_nt_threshold = MT24110_NT_THRESHOLD_DEFAULT;
+
+/* Scalar: libc memset/memcpy, the code path used before */
+static void mt24110_fill_scalar(void *dst, int c, size_t n) {
+    memset(dst, c, n);
+}
+
+static void mt24110_copy_scalar(void *dst, const void *src, size_t n) {
+    memcpy(dst, src, n);
+}
+
+#ifdef MT24110_HAVE_X86
+
+/* Bytes needed to bring p up to an align-byte boundary, capped at n */
+static inline size_t mt24110_head_bytes(const void *p, size_t align, size_t n) {
+    size_t head = (align - ((uintptr_t)p & (align - 1))) & (align - 1);
+    return head < n ? head : n;
+}
+
+/* SSE2: baseline on x86-64 */
+__attribute__((target("sse2")))
+static void mt24110_fill_sse2(void *dst, int c, size_t n) {
+    char *p = dst;
+    __m128i v = _mm_set1_epi8((char)c);
+    for (; n >= 64; p += 64, n -= 64) {
+        _mm_storeu_si128((__m128i *)p, v);
+        _mm_storeu_si128((__m128i *)(p + 16), v);
+        _mm_storeu_si128((__m128i *)(p + 32), v);
+        _mm_storeu_si128((__m128i *)(p + 48), v);
+    }
+    for (; n >= 16; p += 16, n -= 16) {
+        _mm_storeu_si128((__m128i *)p, v);
+    }
+    memset(p, c, n);
+}
+
+__attribute__((target("sse2")))
+static void mt24110_fill_nt_sse2(void *dst, int c, size_t n) {
+    char *p = dst;
+    size_t head = mt24110_head_bytes(p, 16, n);
+    memset(p, c, head);
+    p += head;
+    n -= head;
+
+    __m128i v = _mm_set1_epi8((char)c);
+    for (; n >= 64; p += 64, n -= 64) {
+        _mm_stream_si128((__m128i *)p, v);
+        _mm_stream_si128((__m128i *)(p + 16), v);
+        _mm_stream_si128((__m128i *)(p + 32), v);
+        _mm_stream_si128((__m128i *)(p + 48), v);
+    }
+    _mm_sfence();
+    memset(p, c, n);
+}
+
+__attribute__((target("sse2")))
+static void mt24110_copy_sse2(void *dst, const void *src, size_t n) {
+    char *d = dst;
+    const char *s = src;
+    for (; n >= 64; d += 64, s += 64, n -= 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *)s);
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+        __m128i e = _mm_loadu_si128((const __m128i *)(s + 32));
+        __m128i f = _mm_loadu_si128((const __m128i *)(s + 48));
+        _mm_storeu_si128((__m128i *)d, a);
+        _mm_storeu_si128((__m128i *)(d + 16), b);
+        _mm_storeu_si128((__m128i *)(d + 32), e);
+        _mm_storeu_si128((__m128i *)(d + 48), f);
+    }
+    memcpy(d, s, n);
+}
+
+__attribute__((target("sse2")))
+static void mt24110_copy_nt_sse2(void *dst, const void *src, size_t n) {
+    char *d = dst;
+    const char *s = src;
+    size_t head = mt24110_head_bytes(d, 16, n);
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    for (; n >= 64; d += 64, s += 64, n -= 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *)s);
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+        __m128i e = _mm_loadu_si128((const __m128i *)(s + 32));
+        __m128i f = _mm_loadu_si128((const __m128i *)(s + 48));
+        _mm_stream_si128((__m128i *)d, a);
+        _mm_stream_si128((__m128i *)(d + 16), b);
+        _mm_stream_si128((__m128i *)(d + 32), e);
+        _mm_stream_si128((__m128i *)(d + 48), f);
+    }
+    _mm_sfence();
+    memcpy(d, s, n);
+}
+
+/* AVX2: 32-byte lanes, 128 bytes per iteration */
+__attribute__((target("avx2")))
+static void mt24110_fill_avx2(void *dst, int c, size_t n) {
+    char *p = dst;
+    __m256i v = _mm256_set1_epi8((char)c);
+    for (; n >= 128; p += 128, n -= 128) {
+        _mm256_storeu_si256((__m256i *)p, v);
+        _mm256_storeu_si256((__m256i *)(p + 32), v);
+        _mm256_storeu_si256((__m256i *)(p + 64), v);
+        _mm256_storeu_si256((__m256i *)(p + 96), v);
+    }
+    for (; n >= 32; p += 32, n -= 32) {
+        _mm256_storeu_si256((__m256i *)p, v);
+    }
+    memset(p, c, n);
+}
+
+__attribute__((target("avx2")))
+static void mt24110_fill_nt_avx2(void *dst, int c, size_t n) {
+    char *p = dst;
+    size_t head = mt24110_head_bytes(p, 32, n);
+    memset(p, c, head);
+    p += head;
+    n -= head;
+
+    __m256i v = _mm256_set1_epi8((char)c);
+    for (; n >= 128; p += 128, n -= 128) {
+        _mm256_stream_si256((__m256i *)p, v);
+        _mm256_stream_si256((__m256i *)(p + 32), v);
+        _mm256_stream_si256((__m256i *)(p + 64), v);
+        _mm256_stream_si256((__m256i *)(p + 96), v);
+    }
+    _mm_sfence();
+    memset(p, c, n);
+}
+
+__attribute__((target("avx2")))
+static void mt24110_copy_avx2(void *dst, const void *src, size_t n) {
+    char *d = dst;
+    const char *s = src;
+    for (; n >= 128; d += 128, s += 128, n -= 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)s);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(s + 32));
+        __m256i e = _mm256_loadu_si256((const __m256i *)(s + 64));
+        __m256i f = _mm256_loadu_si256((const __m256i *)(s + 96));
+        _mm256_storeu_si256((__m256i *)d, a);
+        _mm256_storeu_si256((__m256i *)(d + 32), b);
+        _mm256_storeu_si256((__m256i *)(d + 64), e);
+        _mm256_storeu_si256((__m256i *)(d + 96), f);
+    }
+    memcpy(d, s, n);
+}
+
+__attribute__((target("avx2")))
+static void mt24110_copy_nt_avx2(void *dst, const void *src, size_t n) {
+    char *d = dst;
+    const char *s = src;
+    size_t head = mt24110_head_bytes(d, 32, n);
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    for (; n >= 128; d += 128, s += 128, n -= 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)s);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(s + 32));
+        __m256i e = _mm256_loadu_si256((const __m256i *)(s + 64));
+        __m256i f = _mm256_loadu_si256((const __m256i *)(s + 96));
+        _mm256_stream_si256((__m256i *)d, a);
+        _mm256_stream_si256((__m256i *)(d + 32), b);
+        _mm256_stream_si256((__m256i *)(d + 64), e);
+        _mm256_stream_si256((__m256i *)(d + 96), f);
+    }
+    _mm_sfence();
+    memcpy(d, s, n);
+}
+
+#endif /* MT24110_HAVE_X86 */
+
+/* Ordered from most to least preferred */
+static const MT24110_MemKernels mt24110_kernel_sets[] = {
+#ifdef MT24110_HAVE_X86
+    { "avx2", mt24110_fill_avx2, mt24110_fill_nt_avx2, mt24110_copy_avx2, mt24110_copy_nt_avx2 },
+    { "sse2", mt24110_fill_sse2, mt24110_fill_nt_sse2, mt24110_copy_sse2, mt24110_copy_nt_sse2 },
+#endif
+    { "scalar", mt24110_fill_scalar, mt24110_fill_scalar, mt24110_copy_scalar, mt24110_copy_scalar },
+};
+
+#define MT24110_NUM_KERNEL_SETS (int)(sizeof(mt24110_kernel_sets) / sizeof(mt24110_kernel_sets[0]))
+
+static const MT24110_MemKernels *active_kernels = &mt24110_kernel_sets[MT24110_NUM_KERNEL_SETS - 1];
+
+static int mt24110_kernels_supported(const MT24110_MemKernels *k) {
+#ifdef MT24110_HAVE_X86
+    if (strcmp(k->name, "avx2") == 0) return __builtin_cpu_supports("avx2");
+    if (strcmp(k->name, "sse2") == 0) return __builtin_cpu_supports("sse2");
+#endif
+    return strcmp(k->name, "scalar") == 0;
+}
+
+/*
+ * Pick the best supported set before main() runs. Streaming stores only
+ * pay off once the buffer would not fit in the cache anyway, so the
+ * threshold follows the last-level cache size when the system reports it.
+ */
+__attribute__((constructor))
+static void mt24110_kernels_init(void) {
+#ifdef MT24110_HAVE_X86
+    __builtin_cpu_init();
+#endif
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (llc > 0) {
+        mt24110_nt_threshold = (size_t)llc / 2;
+    }
+#endif
+    for (int i = 0; i < MT24110_NUM_KERNEL_SETS; i++) {
+        if (mt24110_kernels_supported(&mt24110_kernel_sets[i])) {
+            active_kernels = &mt24110_kernel_sets[i];
+            return;
+        }
+    }
+}
+
+const MT24110_MemKernels *mt24110_kernels_active(void) {
+    return active_kernels;
+}
+
+/*
+ * Return the named set if this CPU supports it, NULL otherwise
+ */
+const MT24110_MemKernels *mt24110_kernels_lookup(const char *name) {
+    for (int i = 0; i < MT24110_NUM_KERNEL_SETS; i++) {
+        if (strcmp(mt24110_kernel_sets[i].name, name) == 0) {
+            return mt24110_kernels_supported(&mt24110_kernel_sets[i]) ? &mt24110_kernel_sets[i] : NULL;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Force a kernel set by name. Returns 0 on success, -1 if unknown or
+ * unsupported (the active set is left unchanged).
+ */
+int mt24110_kernels_select(const char *name) {
+    const MT24110_MemKernels *k = mt24110_kernels_lookup(name);
+    if (k == NULL) return -1;
+    active_kernels = k;
+    return 0;
+}
+
+/*
+ * Fill n bytes with c. Below the threshold glibc's memset (itself
+ * vectorized and tuned per CPU) is as fast as the set's own fill, so it
+ * is used; above it the set's streaming fill keeps the cache intact.
+ */
+void mt24110_fill(void *dst, int c, size_t n) {
+    if (n >= mt24110_nt_threshold) {
+        active_kernels->fill_nt(dst, c, n);
+    } else {
+        memset(dst, c, n);
+    }
+}
+
+/* Copy n bytes (regions must not overlap), same policy as mt24110_fill */
+void mt24110_copy(void *dst, const void *src, size_t n) {
+    if (n >= mt24110_nt_threshold) {
+        active_kernels->copy_nt(dst, src, n);
+    } else {
+        memcpy(dst, src, n);
+    }
+}
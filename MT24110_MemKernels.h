@@ -0,0 +1,40 @@
+/*
+ * MT24110_MemKernels.h
+ * CPUID-dispatched fill and copy kernels for payload generation
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * The best kernel set the CPU supports (avx2, sse2, scalar) is chosen
+ * once at program start. Buffers of at least mt24110_nt_threshold bytes
+ * (half the last-level cache) are written with non-temporal (streaming)
+ * stores so building a large payload does not evict the rest of the
+ * cache; smaller ones go through libc.
+ */
+
+#ifndef MT24110_MEMKERNELS_H
+#define MT24110_MEMKERNELS_H
+
+#include <stddef.h>
+
+/* Size from which fill/copy switch to streaming stores if the LLC size is unknown */
+#define MT24110_NT_THRESHOLD_DEFAULT (4 * 1024 * 1024)
+
+typedef struct {
+    const char *name;
+    void (*fill)(void *dst, int c, size_t n);
+    void (*fill_nt)(void *dst, int c, size_t n);
+    void (*copy)(void *dst, const void *src, size_t n);
+    void (*copy_nt)(void *dst, const void *src, size_t n);
+} MT24110_MemKernels;
+
+extern size_t mt24110_nt_threshold;
+
+/* Function prototypes */
+const MT24110_MemKernels *mt24110_kernels_active(void);
+const MT24110_MemKernels *mt24110_kernels_lookup(const char *name);
+int mt24110_kernels_select(const char *name);
+void mt24110_fill(void *dst, int c, size_t n);
+void mt24110_copy(void *dst, const void *src, size_t n);
+
+#endif /* MT24110_MEMKERNELS_H */
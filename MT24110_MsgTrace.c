@@ -0,0 +1,315 @@
+/*
+ * MT24110_MsgTrace.c
+ * Per-message lifecycle timestamps written to a binary trace file
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_MsgTrace.h"
+#include "MT24110_Transport.h"
+#include "MT24110_Ring.h"
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+/* Records buffered per connection; 512 KB covers many writer intervals */
+#define MT24110_MSGTRACE_RING_SIZE 16384
+#define MT24110_MSGTRACE_FLUSH_MS 10
+#define MT24110_MSGTRACE_BATCH 256
+
+MT24110_SPSC_RING_DEFINE(MT24110_TraceRing, mt24110_trace_ring, MT24110_TraceRecord)
+
+struct MT24110_TraceStream {
+    MT24110_TraceRing ring;
+    int fd;
+    uint16_t port;
+    uint16_t thread;
+    int kernel_stamps;          /* SO_TIMESTAMPING enabled on fd */
+    uint64_t tx_offset;         /* bytes sent so far */
+    uint64_t rx_offset;         /* bytes received so far */
+    uint32_t tx_seq;
+    uint32_t rx_seq;
+    long acks_pending;          /* sends whose TX_ACK stamp has not been read */
+    atomic_long dropped;
+    atomic_int closed;          /* owner is done; the writer frees it */
+    struct MT24110_TraceStream *next;
+};
+
+/* The stream of the calling thread, for stamps read off the error queue */
+static __thread MT24110_TraceStream *current_stream;
+
+static pthread_mutex_t msgtrace_lock = PTHREAD_MUTEX_INITIALIZER;
+static MT24110_TraceStream *streams;
+static FILE *trace_fp;
+static const char *trace_path;
+static int trace_server;
+static long records_written;
+static long records_dropped;
+
+static pthread_t writer_tid;
+static atomic_int writer_running;
+
+static uint64_t mt24110_realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Move every queued record to the file and free streams whose owner
+ * has closed them. Caller holds msgtrace_lock.
+ */
+static void mt24110_msgtrace_drain(void) {
+    MT24110_TraceRecord batch[MT24110_MSGTRACE_BATCH];
+    MT24110_TraceStream **link = &streams;
+
+    while (*link != NULL) {
+        MT24110_TraceStream *s = *link;
+        /* Read closed first: everything pushed before it is drained below */
+        int closed = atomic_load(&s->closed);
+
+        size_t n;
+        while ((n = mt24110_trace_ring_pop_batch(&s->ring, batch, MT24110_MSGTRACE_BATCH)) > 0) {
+            fwrite(batch, sizeof(MT24110_TraceRecord), n, trace_fp);
+            records_written += n;
+        }
+
+        if (closed) {
+            records_dropped += atomic_load(&s->dropped);
+            *link = s->next;
+            mt24110_trace_ring_destroy(&s->ring);
+            free(s);
+        } else {
+            link = &s->next;
+        }
+    }
+}
+
+static void *mt24110_msgtrace_writer(void *arg) {
+    (void)arg;
+    struct timespec interval = { 0, MT24110_MSGTRACE_FLUSH_MS * 1000000L };
+
+    while (atomic_load(&writer_running)) {
+        nanosleep(&interval, NULL);
+        pthread_mutex_lock(&msgtrace_lock);
+        mt24110_msgtrace_drain();
+        pthread_mutex_unlock(&msgtrace_lock);
+    }
+    return NULL;
+}
+
+/*
+ * Open the trace file and start the writer thread. path == NULL leaves
+ * tracing disabled. Returns 0 on success, -1 if the file cannot be written.
+ */
+int mt24110_msgtrace_start(const char *path, int server) {
+    if (path == NULL) return 0;
+
+    trace_fp = fopen(path, "wb");
+    if (trace_fp == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    MT24110_TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MT24110_MSGTRACE_MAGIC, sizeof(header.magic));
+    header.version = MT24110_MSGTRACE_VERSION;
+    header.record_size = sizeof(MT24110_TraceRecord);
+    header.role = server ? 1 : 0;
+    header.pid = (uint32_t)getpid();
+    fwrite(&header, sizeof(header), 1, trace_fp);
+
+    trace_path = path;
+    trace_server = server;
+    atomic_store(&writer_running, 1);
+    if (pthread_create(&writer_tid, NULL, mt24110_msgtrace_writer, NULL) != 0) {
+        perror("pthread_create trace writer failed");
+        atomic_store(&writer_running, 0);
+        fclose(trace_fp);
+        trace_fp = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Stop the writer and flush what is left. Streams should be
+ * closed first; records of streams still open are flushed as well.
+ */
+void mt24110_msgtrace_stop(void) {
+    if (!atomic_exchange(&writer_running, 0)) return;
+    pthread_join(writer_tid, NULL);
+
+    pthread_mutex_lock(&msgtrace_lock);
+    mt24110_msgtrace_drain();
+    for (MT24110_TraceStream *s = streams; s != NULL; s = s->next) {
+        records_dropped += atomic_exchange(&s->dropped, 0);
+    }
+    fclose(trace_fp);
+    trace_fp = NULL;
+    pthread_mutex_unlock(&msgtrace_lock);
+}
+
+/*
+ * Report where the trace went and how many records were lost
+ */
+void mt24110_msgtrace_print(void) {
+    if (trace_path == NULL) return;
+
+    printf("\n=== Message Trace ===\n");
+    printf("Records: %ld written to %s, %ld dropped (ring full)\n",
+           records_written, trace_path, records_dropped);
+}
+
+/*
+ * Start tracing the connection on fd for the calling thread. With
+ * kernel_stamps, also asks the kernel for software TX stamps keyed by
+ * byte offset; they are read by mt24110_reap_zerocopy. Must be called
+ * before the first byte is sent. Returns NULL when tracing is off.
+ */
+MT24110_TraceStream *mt24110_msgtrace_open(int fd, int thread, int kernel_stamps) {
+    if (!atomic_load(&writer_running)) return NULL;
+
+    MT24110_TraceStream *s = aligned_alloc(MT24110_CACHE_LINE, sizeof(MT24110_TraceStream));
+    MT24110_CHECK_NULL(s, "malloc trace stream");
+    memset(s, 0, sizeof(*s));
+    if (mt24110_trace_ring_init(&s->ring, MT24110_MSGTRACE_RING_SIZE,
+                                MT24110_RING_NONBLOCKING) < 0) {
+        perror("malloc trace ring");
+        exit(EXIT_FAILURE);
+    }
+    s->fd = fd;
+    s->thread = (uint16_t)thread;
+
+    /* The client's port names the connection on both sides */
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int rc = trace_server ? getpeername(fd, (struct sockaddr *)&addr, &len)
+                          : getsockname(fd, (struct sockaddr *)&addr, &len);
+    if (rc == 0) s->port = ntohs(addr.sin_port);
+
+    if (kernel_stamps) {
+        int flags = SOF_TIMESTAMPING_TX_SCHED | SOF_TIMESTAMPING_TX_SOFTWARE |
+                    SOF_TIMESTAMPING_TX_ACK | SOF_TIMESTAMPING_SOFTWARE |
+                    SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+            s->kernel_stamps = 1;
+        } else if (thread == 0) {
+            printf("Warning: SO_TIMESTAMPING not supported, tracing user-space stamps only\n");
+        }
+    }
+
+    pthread_mutex_lock(&msgtrace_lock);
+    s->next = streams;
+    streams = s;
+    pthread_mutex_unlock(&msgtrace_lock);
+
+    current_stream = s;
+    return s;
+}
+
+/*
+ * Stop tracing. The writer flushes the remaining records and frees the
+ * stream, which must not be used afterwards.
+ */
+void mt24110_msgtrace_close(MT24110_TraceStream *stream) {
+    if (stream == NULL) return;
+    if (current_stream == stream) current_stream = NULL;
+    atomic_store(&stream->closed, 1);
+}
+
+static void mt24110_msgtrace_push(MT24110_TraceStream *s, const MT24110_TraceRecord *rec) {
+    if (!mt24110_trace_ring_push(&s->ring, *rec)) {
+        atomic_fetch_add_explicit(&s->dropped, 1, memory_order_relaxed);
+    }
+}
+
+/*
+ * Record a user-space stage of the current message. Send events
+ * describe size bytes starting at the send offset, receive events size
+ * bytes at the receive offset; _EXIT / _SEND / _RECV advance it.
+ * No-op on a NULL stream.
+ */
+void mt24110_msgtrace_stamp(MT24110_TraceStream *stream, MT24110_TraceEvent event, int size, int path) {
+    if (stream == NULL) return;
+
+    MT24110_TraceRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.ts_ns = mt24110_realtime_ns();
+    rec.size = (uint32_t)size;
+    rec.port = stream->port;
+    rec.thread = stream->thread;
+    rec.event = (uint8_t)event;
+    rec.path = (uint8_t)path;
+
+    switch (event) {
+    case MT24110_TRACE_SEND_ENTER:
+        rec.offset = stream->tx_offset + size;
+        rec.seq = stream->tx_seq;
+        break;
+    case MT24110_TRACE_SEND_EXIT:
+    case MT24110_TRACE_SERVER_SEND:
+        stream->tx_offset += size;
+        rec.offset = stream->tx_offset;
+        rec.seq = stream->tx_seq++;
+        if (stream->kernel_stamps) stream->acks_pending++;
+        break;
+    default:
+        stream->rx_offset += size;
+        rec.offset = stream->rx_offset;
+        rec.seq = stream->rx_seq++;
+        break;
+    }
+    mt24110_msgtrace_push(stream, &rec);
+}
+
+/* Non-zero while the calling thread's stream expects TX_ACK stamps */
+int mt24110_msgtrace_stamps_pending(void) {
+    return current_stream != NULL && current_stream->acks_pending > 0;
+}
+
+/*
+ * Record one SO_TIMESTAMPING stamp read off the error queue of the
+ * calling thread's socket. ee_data is the key of the send's last byte
+ * (32 bits, counted from mt24110_msgtrace_open), which is widened to the
+ * stream offset just past it.
+ */
+void mt24110_msgtrace_kernel_stamp(const struct sock_extended_err *serr,
+                                   const struct scm_timestamping *tss) {
+    MT24110_TraceStream *s = current_stream;
+    if (s == NULL) return;
+
+    MT24110_TraceRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    switch (serr->ee_info) {
+    case SCM_TSTAMP_SCHED: rec.event = MT24110_TRACE_TX_SCHED; break;
+    case SCM_TSTAMP_SND:   rec.event = MT24110_TRACE_TX_SOFTWARE; break;
+    case SCM_TSTAMP_ACK:
+        rec.event = MT24110_TRACE_TX_ACK;
+        if (s->acks_pending > 0) s->acks_pending--;
+        break;
+    default:
+        return;
+    }
+
+    uint32_t end = serr->ee_data + 1;
+    rec.ts_ns = (uint64_t)tss->ts[0].tv_sec * 1000000000ULL + tss->ts[0].tv_nsec;
+    rec.offset = s->tx_offset - (uint32_t)((uint32_t)s->tx_offset - end);
+    rec.port = s->port;
+    rec.thread = s->thread;
+    mt24110_msgtrace_push(s, &rec);
+}
+
+/*
+ * Read the kernel stamps queued so far on a socket that carries no
+ * zero-copy sends (MSG_ZEROCOPY clients reap through their own counters)
+ */
+void mt24110_msgtrace_reap(MT24110_TraceStream *stream) {
+    if (stream == NULL || !stream->kernel_stamps) return;
+
+    MT24110_PathCounters none;
+    memset(&none, 0, sizeof(none));
+    mt24110_reap_zerocopy(stream->fd, &none, 0);
+}
@@ -0,0 +1,88 @@
+/*
+ * MT24110_MsgTrace.h
+ * Per-message lifecycle timestamps written to a binary trace file
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * With --msg-trace=FILE every traced connection stamps the stages a
+ * message passes through:
+ *   client  SEND_ENTER / SEND_EXIT   around the send call
+ *   kernel  TX_SCHED / TX_SOFTWARE / TX_ACK  SO_TIMESTAMPING stamps for
+ *           the last byte of the send: entering the qdisc, handed to the
+ *           driver, acknowledged by the peer (when the kernel supports it)
+ *   server  SERVER_RECV / SERVER_SEND  after each recv()/send() chunk
+ *   client  RECV                     once the whole echo has arrived
+ * Records carry the stream offset just past their bytes and the client's
+ * port, so the decoder (MT24110_decode_msg_trace.py) joins a client file
+ * with a server file and breaks each round trip down by stage. All stamps
+ * use CLOCK_REALTIME, the clock of the kernel's software timestamps, so
+ * files from two processes on one host line up.
+ *
+ * Each connection pushes its records into its own SPSC ring
+ * (MT24110_Ring.h); one writer thread per process drains the rings into
+ * the file. A full ring drops records (counted) rather than stall the
+ * connection.
+ */
+
+#ifndef MT24110_MSGTRACE_H
+#define MT24110_MSGTRACE_H
+
+#include <stdint.h>
+
+#define MT24110_MSGTRACE_MAGIC "MT24TRC1"
+#define MT24110_MSGTRACE_VERSION 1
+
+typedef enum {
+    MT24110_TRACE_SEND_ENTER,
+    MT24110_TRACE_SEND_EXIT,
+    MT24110_TRACE_TX_SCHED,
+    MT24110_TRACE_TX_SOFTWARE,
+    MT24110_TRACE_TX_ACK,
+    MT24110_TRACE_SERVER_RECV,
+    MT24110_TRACE_SERVER_SEND,
+    MT24110_TRACE_RECV,
+    MT24110_TRACE_EVENT_COUNT
+} MT24110_TraceEvent;
+
+/* One fixed-size record in the file (little-endian, 32 bytes) */
+typedef struct {
+    uint64_t ts_ns;             /* CLOCK_REALTIME */
+    uint64_t offset;            /* stream offset just past this message/chunk */
+    uint32_t seq;               /* message (client) or chunk (server) number */
+    uint32_t size;
+    uint16_t port;              /* client's local port, joins the two sides */
+    uint16_t thread;
+    uint8_t event;              /* MT24110_TraceEvent */
+    uint8_t path;               /* MT24110_SendPath of client sends */
+    uint8_t reserved[2];
+} MT24110_TraceRecord;
+
+/* File header, followed by records in per-connection batches */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t role;              /* 0 = client, 1 = server */
+    uint32_t pid;
+} MT24110_TraceHeader;
+
+/* Per-connection trace state, owned by the connection's thread */
+typedef struct MT24110_TraceStream MT24110_TraceStream;
+
+struct sock_extended_err;
+struct scm_timestamping;
+
+/* Function prototypes */
+int mt24110_msgtrace_start(const char *path, int server);
+void mt24110_msgtrace_stop(void);
+void mt24110_msgtrace_print(void);
+MT24110_TraceStream *mt24110_msgtrace_open(int fd, int thread, int kernel_stamps);
+void mt24110_msgtrace_close(MT24110_TraceStream *stream);
+void mt24110_msgtrace_stamp(MT24110_TraceStream *stream, MT24110_TraceEvent event, int size, int path);
+int mt24110_msgtrace_stamps_pending(void);
+void mt24110_msgtrace_reap(MT24110_TraceStream *stream);
+void mt24110_msgtrace_kernel_stamp(const struct sock_extended_err *serr,
+                                   const struct scm_timestamping *tss);
+
+#endif /* MT24110_MSGTRACE_H */
@@ -9,68 +9,347 @@
  * Copy 1: User buffer -> Kernel socket buffer (via send())
  * Copy 2: Kernel socket buffer -> User buffer (via recv())
  * Total: 2 copies between user and kernel space
+ *
+ * Each received chunk passes through a processing stage (--handler). It runs
+ * inline on the connection thread or, with --dispatch=handoff, on a
+ * work-stealing worker pool: the connection thread keeps receiving while
+ * up to MT24110_HANDOFF_DEPTH chunks are processed, and echoes them in
+ * receive order as they complete.
+ *
+ * --prefork=N replaces the thread-per-connection model with N worker
+ * processes running epoll loops under a supervisor (MT24110_PreFork.c).
+ *
+ * --msg-trace=FILE timestamps every recv()/send() chunk so the decoder can
+ * split client round trips into stages (MT24110_MsgTrace.h).
+ *
+ * Echoes are sent without blocking: what a slow client does not read is
+ * queued per connection, and reading from it pauses between the
+ * --high-water/--low-water marks (MT24110_Flow.h).
+ *
+ * Shutdown: SIGINT/SIGTERM signal an eventfd that the accept loop watches.
+ * Connection threads keep serving in blocking recv() for at most
+ * --drain-ms; the main thread then shuts down the sockets of those still
+ * running, joins them and prints the aggregated statistics.
  */
 
 #include "MT24110_Common.h"
+#include "MT24110_WorkerPool.h"
+#include "MT24110_SockOpt.h"
+#include "MT24110_Telemetry.h"
+#include "MT24110_PreFork.h"
+#include "MT24110_MsgTrace.h"
+#include "MT24110_Flow.h"
+#include <sys/eventfd.h>
+
+/* Chunks of one connection on the worker pool at once (--dispatch=handoff) */
+#define MT24110_HANDOFF_DEPTH 8
 
 MT24110_ServerConfig config;
 volatile int server_running = 1;
+const MT24110_Handler *msg_handler;
+MT24110_WorkerPool *worker_pool;   /* NULL for run-to-completion */
+MT24110_Stats server_stats;        /* folded in as connections are joined */
+MT24110_SockOptProfile sock_profile;
+MT24110_SockOptProfile sock_effective;
+int sock_effective_valid;
+int sock_differing;                /* accepted sockets whose options differ from the first */
+MT24110_FlowConfig flow_config;
+MT24110_FlowCounters flow_totals;  /* folded in as connections are joined */
+uint32_t server_checksum;          /* sum of every connection's handler checksum */
+
+/* Per-connection state; the list is only touched by the main thread */
+typedef struct MT24110_Connection {
+    pthread_t tid;
+    int client_fd;
+    int id;                     /* accept order, names the connection in traces */
+    char peer[INET_ADDRSTRLEN + 8];
+    MT24110_Stats stats;
+    MT24110_FlowCounters flow;  /* valid once finished */
+    pthread_mutex_t fd_lock;    /* client_fd is -1 once closed; main may shut it down */
+    uint32_t checksum;          /* handler checksum, valid once finished */
+    atomic_int finished;
+    struct MT24110_Connection *next;
+} MT24110_Connection;
+
+MT24110_Connection *connections;
+long connections_served;
+long connections_accepted;
 
 /* Signal handler for graceful shutdown */
 void mt24110_signal_handler(int sig) {
     (void)sig;
     server_running = 0;
+    mt24110_shutdown_trigger();
 }
 
-/* Handle client connection - one thread per client */
-void *mt24110_client_handler(void *arg) {
-    int client_fd = *(int *)arg;
-    free(arg);
+/*
+ * Echo the chunks of finished jobs, oldest first, stopping at the first
+ * job still running or when the queue cap left an echo held in its job
+ * buffer. Returns -1 when the connection failed.
+ */
+static int mt24110_handoff_reply(MT24110_Connection *conn, MT24110_OutQueue *out, MT24110_TraceStream *trace,
+                                 MT24110_Job *jobs, int *head, int *in_flight) {
+    while (*in_flight > 0 && !mt24110_outq_holding(out) && mt24110_job_done(&jobs[*head])) {
+        MT24110_Job *job = &jobs[*head];
+        int sent = mt24110_outq_send(out, conn->client_fd, job->buffer, job->result_len, &flow_config);
+        if (sent < 0) {
+            if (errno != EPIPE && errno != ECONNRESET) perror("send failed");
+            return -1;
+        }
+        if (sent > 0) {
+            mt24110_msgtrace_stamp(trace, MT24110_TRACE_SERVER_SEND, sent, 0);
+        }
+        atomic_fetch_add(&conn->stats.bytes_sent, sent);
+        atomic_fetch_add(&conn->stats.messages_sent, 1);
+
+        *head = (*head + 1) % MT24110_HANDOFF_DEPTH;
+        (*in_flight)--;
+    }
+    return 0;
+}
+
+/*
+ * --dispatch=handoff: receive into a ring of MT24110_HANDOFF_DEPTH job
+ * buffers and submit each chunk to the pool without waiting. Workers
+ * signal completions on an eventfd; replies leave in receive order.
+ */
+static void mt24110_serve_handoff(MT24110_Connection *conn, MT24110_OutQueue *out, MT24110_TraceStream *trace) {
+    int client_fd = conn->client_fd;
+    MT24110_Stats *local_stats = &conn->stats;
+
+    int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd < 0) {
+        perror("eventfd failed");
+        return;
+    }
+    char *buffers = malloc((size_t)config.message_size * MT24110_HANDOFF_DEPTH);
+    MT24110_CHECK_NULL(buffers, "malloc handoff buffers");
+
+    MT24110_Job jobs[MT24110_HANDOFF_DEPTH];
+    for (int i = 0; i < MT24110_HANDOFF_DEPTH; i++) {
+        mt24110_job_init(&jobs[i], msg_handler->fn, efd);
+    }
+    int head = 0, in_flight = 0, eof = 0;
+    long submitted = 0, notified = 0;
+    uint64_t n;
+
+    while (mt24110_handoff_reply(conn, out, trace, jobs, &head, &in_flight) == 0) {
+        if (eof && in_flight == 0) break;
+
+        int reading = !eof && in_flight < MT24110_HANDOFF_DEPTH &&
+                      mt24110_outq_can_read(out);
+        short events = (reading ? POLLIN : 0) | (mt24110_outq_pending(out) > 0 ? POLLOUT : 0);
+        struct pollfd pfd[2] = {
+            { .fd = events ? client_fd : -1, .events = events, .revents = 0 },
+            { .fd = efd, .events = POLLIN, .revents = 0 },
+        };
+        int ready = mt24110_wait_fds(pfd, 2, 1, -1);
+        if (ready <= 0) {
+            if (ready < 0) perror("poll failed");
+            break;
+        }
+
+        if ((pfd[1].revents & POLLIN) && read(efd, &n, sizeof(n)) == sizeof(n)) {
+            notified += (long)n;
+        }
+        if (mt24110_outq_pending(out) > 0 && pfd[0].revents != 0) {
+            int flushed = mt24110_outq_flush(out, client_fd, &flow_config);
+            if (flushed < 0) {
+                if (errno != EPIPE && errno != ECONNRESET) perror("send failed");
+                break;
+            }
+            if (flushed > 0) {
+                mt24110_msgtrace_stamp(trace, MT24110_TRACE_SERVER_SEND, flushed, 0);
+                atomic_fetch_add(&local_stats->bytes_sent, flushed);
+            }
+        }
+        if (!reading || pfd[0].revents == 0) continue;
+
+        int tail = (head + in_flight) % MT24110_HANDOFF_DEPTH;
+        char *buffer = buffers + (size_t)tail * config.message_size;
+        int received = recv(client_fd, buffer, config.message_size, MSG_DONTWAIT);
+        if (received == 0) {
+            printf("Client %s disconnected\n", conn->peer);
+            eof = 1;    /* still echo what is on the pool */
+            continue;
+        }
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+            if (errno != ECONNRESET) perror("recv failed");
+            break;
+        }
+
+        mt24110_msgtrace_stamp(trace, MT24110_TRACE_SERVER_RECV, received, 0);
+        atomic_fetch_add(&local_stats->bytes_received, received);
+        atomic_fetch_add(&local_stats->messages_received, 1);
+
+        mt24110_pool_submit(worker_pool, &jobs[tail], buffer, received);
+        submitted++;
+        in_flight++;
+    }
+
+    /* Workers write the eventfd last; only then are the jobs ours again */
+    while (notified < submitted) {
+        struct pollfd pfd = { .fd = efd, .events = POLLIN, .revents = 0 };
+        poll(&pfd, 1, -1);
+        if (read(efd, &n, sizeof(n)) == sizeof(n)) notified += (long)n;
+    }
+    for (int i = 0; i < MT24110_HANDOFF_DEPTH; i++) {
+        conn->checksum += jobs[i].checksum;
+    }
+    close(efd);
+    free(buffers);
+}
+
+/*
+ * --dispatch=inline: receive a chunk, run the handler on this thread and
+ * echo it, until the client leaves or the drain period ends
+ */
+static void mt24110_serve_inline(MT24110_Connection *conn, MT24110_OutQueue *out, MT24110_TraceStream *trace) {
+    int client_fd = conn->client_fd;
+    MT24110_Stats *local_stats = &conn->stats;
 
     char *buffer = malloc(config.message_size);
     MT24110_CHECK_NULL(buffer, "malloc handler buffer");
 
-    MT24110_Stats local_stats;
-    mt24110_init_stats(&local_stats);
+    for (;;) {
+        /* Backlog first, so queued echoes keep their order */
+        if (mt24110_outq_pending(out) > 0) {
+            int reading = mt24110_outq_can_read(out);
+            int ready = mt24110_wait_fd(client_fd, (reading ? POLLIN : 0) | POLLOUT, 1);
+            if (ready <= 0) {
+                if (ready < 0) perror("poll failed");
+                break;
+            }
+            int flushed = mt24110_outq_flush(out, client_fd, &flow_config);
+            if (flushed < 0) {
+                if (errno != EPIPE && errno != ECONNRESET) perror("send failed");
+                break;
+            }
+            if (flushed > 0) {
+                mt24110_msgtrace_stamp(trace, MT24110_TRACE_SERVER_SEND, flushed, 0);
+                atomic_fetch_add(&local_stats->bytes_sent, flushed);
+            }
+            if (!reading) continue;
+        }
 
-    /* Receive messages continuously */
-    while (server_running) {
-        int received = recv(client_fd, buffer, config.message_size, 0);
+        /* Nothing queued: a plain blocking recv(), as in the baseline */
+        int received = recv(client_fd, buffer, config.message_size,
+                            mt24110_outq_pending(out) > 0 ? MSG_DONTWAIT : 0);
 
         if (received <= 0) {
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) continue;
             if (received == 0) {
-                printf("Client disconnected\n");
-            } else if (errno != EINTR) {
+                printf("Client %s disconnected\n", conn->peer);
+            } else if (errno != ECONNRESET) {
                 perror("recv failed");
             }
             break;
         }
 
-        atomic_fetch_add(&local_stats.bytes_received, received);
-        atomic_fetch_add(&local_stats.messages_received, 1);
+        mt24110_msgtrace_stamp(trace, MT24110_TRACE_SERVER_RECV, received, 0);
+        atomic_fetch_add(&local_stats->bytes_received, received);
+        atomic_fetch_add(&local_stats->messages_received, 1);
 
-        /* Echo back to client (second copy for response) */
-        int sent = send(client_fd, buffer, received, 0);
+        /* Processing stage, run to completion on this thread */
+        int reply_len = msg_handler->fn(buffer, received, &conn->checksum);
+
+        /* Echo back to client (second copy for response); a slow reader queues */
+        int sent = mt24110_outq_send(out, client_fd, buffer, reply_len, &flow_config);
         if (sent < 0) {
-            perror("send failed");
+            if (errno != EPIPE && errno != ECONNRESET) {
+                perror("send failed");
+            }
             break;
         }
+        if (sent > 0) {
+            mt24110_msgtrace_stamp(trace, MT24110_TRACE_SERVER_SEND, sent, 0);
+        }
 
-        atomic_fetch_add(&local_stats.bytes_sent, sent);
-        atomic_fetch_add(&local_stats.messages_sent, 1);
+        atomic_fetch_add(&local_stats->bytes_sent, sent);
+        atomic_fetch_add(&local_stats->messages_sent, 1);
     }
 
     free(buffer);
+}
+
+/* Handle client connection - one thread per client */
+void *mt24110_client_handler(void *arg) {
+    MT24110_Connection *conn = (MT24110_Connection *)arg;
+    int client_fd = conn->client_fd;
+
+    /* NULL unless --msg-trace is set */
+    MT24110_TraceStream *trace = mt24110_msgtrace_open(client_fd, conn->id, 0);
+
+    /* Echo bytes the socket has not taken yet; gates reading (MT24110_Flow.h) */
+    MT24110_OutQueue out;
+    mt24110_outq_init(&out);
+
+    if (worker_pool != NULL) {
+        mt24110_serve_handoff(conn, &out, trace);
+    } else {
+        mt24110_serve_inline(conn, &out, trace);
+    }
+
+    mt24110_outq_free(&out);
+    conn->flow = out.counters;
+    mt24110_msgtrace_close(trace);
+    mt24110_telemetry_unregister(client_fd);
+
+    pthread_mutex_lock(&conn->fd_lock);
     close(client_fd);
+    conn->client_fd = -1;
+    pthread_mutex_unlock(&conn->fd_lock);
 
+    atomic_store(&conn->finished, 1);
     return NULL;
 }
 
+/*
+ * Join connection threads (finished ones only unless all is set),
+ * fold their statistics into server_stats and free them. With all set a
+ * thread still blocked in recv() when --drain-ms ends has its socket
+ * shut down, which wakes it.
+ */
+void mt24110_reap_connections(int all) {
+    MT24110_Connection **link = &connections;
+
+    while (*link != NULL) {
+        MT24110_Connection *conn = *link;
+        if (!all && !atomic_load(&conn->finished)) {
+            link = &conn->next;
+            continue;
+        }
+
+        if (!all) {
+            pthread_join(conn->tid, NULL);
+        } else if (mt24110_join_drain(conn->tid) != 0) {
+            /* Still serving when --drain-ms ended: wake its recv() */
+            pthread_mutex_lock(&conn->fd_lock);
+            if (conn->client_fd >= 0) shutdown(conn->client_fd, SHUT_RDWR);
+            pthread_mutex_unlock(&conn->fd_lock);
+            pthread_join(conn->tid, NULL);
+        }
+        pthread_mutex_destroy(&conn->fd_lock);
+        atomic_fetch_add(&server_stats.bytes_received, atomic_load(&conn->stats.bytes_received));
+        atomic_fetch_add(&server_stats.bytes_sent, atomic_load(&conn->stats.bytes_sent));
+        atomic_fetch_add(&server_stats.messages_received, atomic_load(&conn->stats.messages_received));
+        atomic_fetch_add(&server_stats.messages_sent, atomic_load(&conn->stats.messages_sent));
+        mt24110_flow_counters_add(&flow_totals, &conn->flow);
+        server_checksum += conn->checksum;
+        connections_served++;
+
+        *link = conn->next;
+        free(conn);
+    }
+}
+
 int main(int argc, char *argv[]) {
     /* Parse command line arguments */
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <port> <message_size>\n", argv[0]);
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <port> <message_size> [options]\n", argv[0]);
         fprintf(stderr, "Example: %s 8080 1024\n", argv[0]);
+        mt24110_print_server_options_usage();
         return EXIT_FAILURE;
     }
 
@@ -78,9 +357,31 @@ int main(int argc, char *argv[]) {
     config.message_size = atoi(argv[2]);
     config.running = 1;
 
+    if (mt24110_parse_server_options(argc, argv, 3, &config) < 0) {
+        mt24110_print_server_options_usage();
+        return EXIT_FAILURE;
+    }
+    msg_handler = mt24110_handler_lookup(config.handler);
+    if (msg_handler == NULL) {
+        fprintf(stderr, "Unknown handler: %s\n", config.handler);
+        return EXIT_FAILURE;
+    }
+    if (mt24110_sockopt_profile_init(config.sockopt_profile, config.sockopt_overrides, &sock_profile) < 0) {
+        return EXIT_FAILURE;
+    }
+    if (mt24110_flow_config_init(config.high_water, config.low_water, config.queue_cap, &flow_config) < 0) {
+        return EXIT_FAILURE;
+    }
+
     /* Setup signal handler for Ctrl+C */
-    signal(SIGINT, mt24110_signal_handler);
-    signal(SIGTERM, mt24110_signal_handler);
+    mt24110_shutdown_init(config.drain_ms);
+    mt24110_install_signal_handler(mt24110_signal_handler);
+    mt24110_init_stats(&server_stats);
+
+    /* Pre-fork mode: this process supervises worker processes instead */
+    if (config.prefork > 0) {
+        return mt24110_prefork_run(&config, msg_handler, &sock_profile, &flow_config);
+    }
 
     /* Create server socket */
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -90,6 +391,9 @@ int main(int argc, char *argv[]) {
     int opt = 1;
     setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
+    /* Accepted sockets inherit buffer sizes set before listen() */
+    mt24110_sockopt_apply_buffers(server_fd, &sock_profile);
+
     /* Bind to port */
     struct sockaddr_in server_addr;
     memset(&server_addr, 0, sizeof(server_addr));
@@ -112,38 +416,93 @@ int main(int argc, char *argv[]) {
 
     printf("Two-copy server listening on port %d\n", config.port);
     printf("Message size: %d bytes\n", config.message_size);
+    if (config.handoff) {
+        worker_pool = mt24110_pool_create(config.num_workers);
+        printf("Handler: %s, handoff to %d workers\n", msg_handler->name, config.num_workers);
+    } else {
+        printf("Handler: %s, run-to-completion\n", msg_handler->name);
+    }
+    mt24110_telemetry_start(config.telemetry_ms);
+    if (mt24110_msgtrace_start(config.msg_trace, 1) < 0) {
+        close(server_fd);
+        return EXIT_FAILURE;
+    }
 
-    /* Accept concurrent clients */
+    /* Accept concurrent clients until shutdown is signalled */
     while (server_running) {
+        if (mt24110_wait_fd(server_fd, POLLIN, 0) <= 0) break;
+
         struct sockaddr_in client_addr;
         socklen_t client_len = sizeof(client_addr);
 
-        int *client_fd = malloc(sizeof(int));
-        *client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &client_len);
+        int client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &client_len);
 
-        if (*client_fd < 0) {
+        if (client_fd < 0) {
             if (errno == EINTR) continue;
             perror("accept failed");
-            free(client_fd);
             continue;
         }
 
-        printf("Client connected from %s:%d\n",
-               inet_ntoa(client_addr.sin_addr),
-               ntohs(client_addr.sin_port));
+        MT24110_Connection *conn = calloc(1, sizeof(MT24110_Connection));
+        MT24110_CHECK_NULL(conn, "malloc connection");
+        conn->client_fd = client_fd;
+        pthread_mutex_init(&conn->fd_lock, NULL);
+        conn->id = (int)connections_accepted++;
+        snprintf(conn->peer, sizeof(conn->peer), "%s:%d",
+                 inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+        mt24110_init_stats(&conn->stats);
+
+        printf("Client connected from %s\n", conn->peer);
+
+        mt24110_sockopt_apply(client_fd, &sock_profile);
+        mt24110_telemetry_register(client_fd);
+        if (!sock_effective_valid) {
+            mt24110_sockopt_read(client_fd, &sock_effective);
+            mt24110_sockopt_print(&sock_profile, &sock_effective, 1, 0);
+            sock_effective_valid = 1;
+        } else {
+            sock_differing += mt24110_sockopt_compare(client_fd, &sock_effective);
+        }
 
         /* Create one thread per client */
-        pthread_t tid;
-        if (pthread_create(&tid, NULL, mt24110_client_handler, client_fd) != 0) {
+        if (pthread_create(&conn->tid, NULL, mt24110_client_handler, conn) != 0) {
             perror("pthread_create failed");
-            close(*client_fd);
-            free(client_fd);
+            mt24110_telemetry_unregister(client_fd);
+            close(client_fd);
+            pthread_mutex_destroy(&conn->fd_lock);
+            free(conn);
         } else {
-            pthread_detach(tid);
+            conn->next = connections;
+            connections = conn;
         }
+
+        /* Join connections that already ended so the list stays short */
+        mt24110_reap_connections(0);
     }
 
+    /* Stop accepting, let handlers drain, then join everything */
     close(server_fd);
+    printf("Draining connections (up to %d ms)\n", config.drain_ms);
+    mt24110_reap_connections(1);
+    mt24110_telemetry_stop();
+    mt24110_msgtrace_stop();
+
+    printf("\nConnections served: %ld\n", connections_served);
+    mt24110_print_stats(&server_stats);
+    if (strcmp(msg_handler->name, "checksum") == 0) {
+        printf("Payload checksum (sum of per-chunk FNV-1a): 0x%08x\n", server_checksum);
+    }
+    if (sock_effective_valid) {
+        mt24110_sockopt_print(&sock_profile, &sock_effective, (int)connections_accepted, sock_differing);
+    }
+    mt24110_telemetry_print();
+    if (config.telemetry_out != NULL) {
+        mt24110_telemetry_write_csv(config.telemetry_out);
+    }
+    mt24110_msgtrace_print();
+    mt24110_flow_print(&flow_totals, &flow_config);
+    mt24110_pool_print_stats(worker_pool);
+    mt24110_pool_destroy(worker_pool);
     printf("Server shutdown complete\n");
 
     return EXIT_SUCCESS;
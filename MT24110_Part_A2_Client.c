@@ -18,79 +18,150 @@
  */
 
 #include "MT24110_Common.h"
+#include "MT24110_SizeDist.h"
+#include "MT24110_SockOpt.h"
+#include "MT24110_Telemetry.h"
+#include "MT24110_HotLoop.h"
+#include "MT24110_Codec.h"
+#include "MT24110_Coalesce.h"
+#include "MT24110_MsgTrace.h"
+#include "MT24110_ClientLoop.h"
 
 MT24110_ClientConfig config;
 MT24110_Stats client_stats;
+MT24110_SizeDist size_dist;
+MT24110_SizeBucketStats client_buckets;
+MT24110_SockOptProfile sock_profile;
+MT24110_SockOptProfile sock_effective;
+int sock_differing;
+MT24110_HotLoopFn hot_loop;         /* NULL: generic per-message loop */
+MT24110_CodecConfig codec;
+MT24110_CodecStats codec_stats;
+MT24110_CoalesceConfig coalesce;
+MT24110_CoalesceStats coalesce_stats;
+
+/* Signal handler: stop early on Ctrl+C, workers drain and exit */
+void mt24110_signal_handler(int sig) {
+    (void)sig;
+    config.running = 0;
+    mt24110_shutdown_trigger();
+}
 
-/* Thread-specific data */
-typedef struct {
-    int thread_id;
-    int sock_fd;
-    long bytes_sent;
-    long bytes_received;
-    long messages_sent;
-    long messages_received;
-    long total_latency_us;
-} MT24110_ThreadData;
-
-/* Worker thread using sendmsg() for one-copy send */
-void *mt24110_worker_thread(void *arg) {
-    MT24110_ThreadData *data = (MT24110_ThreadData *)arg;
-
-    char *buffer = malloc(config.message_size);
-    MT24110_CHECK_NULL(buffer, "malloc buffer");
-
-    /* Create message and serialize once */
-    MT24110_Message *msg = mt24110_create_message(config.message_size);
-    mt24110_serialize_message(msg, buffer, config.message_size);
-    mt24110_destroy_message(msg);
-
+/*
+ * The per-message loop: one sendmsg() from the message buffer, then
+ * recvmsg() into it until the whole echo is back. Used whenever none of
+ * the shared loops applies.
+ */
+void mt24110_run_message_loop(MT24110_ThreadData *data, char *buffer, MT24110_SizeSampler *sampler) {
+    /* msghdr is invariant apart from the iovec, set it up once */
     struct iovec iov[1];
     struct msghdr msg_header;
-    struct timespec start, end;
+    memset(&msg_header, 0, sizeof(msg_header));
+    msg_header.msg_iov = iov;
+    msg_header.msg_iovlen = 1;
+
+    struct timespec thread_start, start, end;
+    clock_gettime(CLOCK_MONOTONIC, &thread_start);
+
+    /* Lifecycle stamps for --msg-trace, NULL otherwise */
+    MT24110_TraceStream *trace = mt24110_msgtrace_open(data->sock_fd, data->thread_id, 1);
 
     while (config.running) {
+        /* Draw this message's size; trace replay also paces the send */
+        long send_at_us;
+        int msg_size = mt24110_sampler_next(sampler, &send_at_us);
+        if (send_at_us >= 0) {
+            mt24110_sleep_until(&thread_start, send_at_us);
+        }
+
         clock_gettime(CLOCK_MONOTONIC, &start);
 
-        /* Prepare msghdr for sendmsg - ONE COPY */
-        memset(&msg_header, 0, sizeof(msg_header));
+        /* Point the iovec at the message - ONE COPY */
         iov[0].iov_base = buffer;
-        iov[0].iov_len = config.message_size;
-        msg_header.msg_iov = iov;
-        msg_header.msg_iovlen = 1;
+        iov[0].iov_len = msg_size;
 
         /* sendmsg sends directly from user buffer - NO COPY to kernel buffer */
+        mt24110_msgtrace_stamp(trace, MT24110_TRACE_SEND_ENTER, msg_size, MT24110_PATH_SENDMSG);
         int sent = sendmsg(data->sock_fd, &msg_header, 0);
         if (sent < 0) {
             perror("sendmsg failed");
             break;
         }
+        mt24110_msgtrace_stamp(trace, MT24110_TRACE_SEND_EXIT, sent, MT24110_PATH_SENDMSG);
         data->bytes_sent += sent;
         data->messages_sent++;
 
         /* Receive still involves one copy (kernel -> user) */
-        memset(&msg_header, 0, sizeof(msg_header));
-        iov[0].iov_base = buffer;
-        iov[0].iov_len = config.message_size;
-        msg_header.msg_iov = iov;
-        msg_header.msg_iovlen = 1;
-
-        int received = recvmsg(data->sock_fd, &msg_header, 0);
+        int received = 0;
+        while (received < sent) {
+            iov[0].iov_base = buffer + received;
+            iov[0].iov_len = sent - received;
+            int r = recvmsg(data->sock_fd, &msg_header, 0);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) {
+                received = r;
+                break;
+            }
+            received += r;
+        }
         if (received <= 0) {
-            if (received == 0) {
-                printf("Server closed connection\n");
-            } else {
+            if (received < 0) {
                 perror("recvmsg failed");
+            } else if (!mt24110_shutdown_requested()) {
+                /* After shutdown, 0 means main cut off the drain */
+                printf("Server closed connection\n");
             }
             break;
         }
         data->bytes_received += received;
         data->messages_received++;
+        mt24110_msgtrace_stamp(trace, MT24110_TRACE_RECV, received, MT24110_PATH_SENDMSG);
+        mt24110_msgtrace_reap(trace);
 
         clock_gettime(CLOCK_MONOTONIC, &end);
         long latency = (end.tv_sec - start.tv_sec) * 1000000L +
                       (end.tv_nsec - start.tv_nsec) / 1000L;
         data->total_latency_us += latency;
+        mt24110_buckets_add(&data->buckets, msg_size, latency);
+    }
+    mt24110_msgtrace_close(trace);
+}
+
+/* Worker thread using sendmsg() for one-copy send */
+void *mt24110_worker_thread(void *arg) {
+    MT24110_ThreadData *data = (MT24110_ThreadData *)arg;
+
+    char *buffer = malloc(size_dist.max_size);
+    MT24110_CHECK_NULL(buffer, "malloc buffer");
+
+    /* Create message and serialize once */
+    MT24110_Message *msg = mt24110_create_message(size_dist.max_size);
+    mt24110_serialize_message(msg, buffer, size_dist.max_size);
+    mt24110_destroy_message(msg);
+
+    MT24110_SizeSampler sampler;
+    mt24110_sampler_init(&sampler, &size_dist, data->thread_id + 1);
+
+    MT24110_LoopSetup setup = {
+        .path = MT24110_PATH_SENDMSG,
+        .coalesce_path = MT24110_PATH_SENDMSG,
+        .policy = NULL,
+        .message_size = config.message_size,
+        .max_size = size_dist.max_size,
+        .running = &config.running,
+    };
+
+    if (hot_loop != NULL) {
+        /* Fixed-size workloads run the loop selected at startup */
+        mt24110_run_hot_loop(data, &setup, hot_loop, buffer, buffer);
+    } else if (codec.enabled) {
+        /* The compression stage runs its own frame loop */
+        mt24110_run_codec_loop(data, &setup, &codec, buffer, &sampler);
+    } else if (coalesce.enabled) {
+        /* Coalescing pipelines messages in its own loop */
+        mt24110_run_coalesce_loop(data, &setup, &coalesce, buffer, &sampler);
+    } else {
+        mt24110_run_message_loop(data, buffer, &sampler);
     }
 
     free(buffer);
@@ -101,13 +172,17 @@ void *mt24110_worker_thread(void *arg) {
     atomic_fetch_add(&client_stats.messages_sent, data->messages_sent);
     atomic_fetch_add(&client_stats.messages_received, data->messages_received);
     atomic_fetch_add(&client_stats.total_latency_us, data->total_latency_us);
+    mt24110_bucket_stats_merge(&client_buckets, &data->buckets);
+    mt24110_codec_stats_merge(&codec_stats, &data->codec);
+    mt24110_coalesce_stats_merge(&coalesce_stats, &data->coalesce);
 
     return NULL;
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 6) {
-        fprintf(stderr, "Usage: %s <server_ip> <port> <message_size> <num_threads> <duration_sec>\n", argv[0]);
+    if (argc < 6) {
+        fprintf(stderr, "Usage: %s <server_ip> <port> <message_size> <num_threads> <duration_sec> [options]\n", argv[0]);
+        mt24110_print_client_options_usage();
         return EXIT_FAILURE;
     }
 
@@ -118,12 +193,59 @@ int main(int argc, char *argv[]) {
     config.duration_sec = atoi(argv[5]);
     config.running = 1;
 
+    if (mt24110_parse_client_options(argc, argv, 6, &config) < 0) {
+        mt24110_print_client_options_usage();
+        return EXIT_FAILURE;
+    }
+    if (mt24110_size_dist_parse(config.size_dist, config.message_size, &size_dist) < 0) {
+        return EXIT_FAILURE;
+    }
+    if (mt24110_sockopt_profile_init(config.sockopt_profile, config.sockopt_overrides, &sock_profile) < 0) {
+        return EXIT_FAILURE;
+    }
+    if (mt24110_codec_config_parse(config.compress, config.compress_min, config.payload,
+                                   size_dist.max_size, &codec) < 0) {
+        return EXIT_FAILURE;
+    }
+    if (mt24110_coalesce_config_parse(config.coalesce, config.window, config.rate, &coalesce) < 0) {
+        return EXIT_FAILURE;
+    }
+    if (codec.enabled && coalesce.enabled) {
+        fprintf(stderr, "--compress and --coalesce cannot be combined\n");
+        return EXIT_FAILURE;
+    }
+    if (config.msg_trace != NULL && (codec.enabled || coalesce.enabled)) {
+        fprintf(stderr, "--msg-trace stamps the per-message loop: not with --compress or --coalesce\n");
+        return EXIT_FAILURE;
+    }
+    if (config.hybrid != NULL) {
+        fprintf(stderr, "--hybrid is only supported by the zero-copy client\n");
+        return EXIT_FAILURE;
+    }
+
     printf("One-copy client connecting to %s:%d\n", config.server_ip, config.port);
     printf("Message size: %d bytes, Threads: %d, Duration: %d sec\n",
            config.message_size, config.num_threads, config.duration_sec);
     printf("Using sendmsg() - one copy eliminated on send path\n");
 
+    if (config.size_dist != NULL) {
+        printf("Size distribution: %s (%d-%d bytes)\n",
+               mt24110_size_dist_name(&size_dist), size_dist.min_size, size_dist.max_size);
+    }
+
+    /* Pick the send/recv loop once; variable sizes and tracing need the generic loop */
+    if (config.size_dist == NULL && config.msg_trace == NULL && !codec.enabled && !coalesce.enabled && config.specialize) {
+        hot_loop = mt24110_hot_loop_select(MT24110_PATH_SENDMSG, config.message_size);
+        printf("Hot loop: %s\n", mt24110_hot_loop_is_specialized(hot_loop)
+               ? "specialized for this message size" : "generic");
+    }
+
+    mt24110_shutdown_init(config.drain_ms);
+    mt24110_install_signal_handler(mt24110_signal_handler);
     mt24110_init_stats(&client_stats);
+    mt24110_bucket_stats_init(&client_buckets);
+    mt24110_codec_stats_init(&codec_stats);
+    mt24110_coalesce_stats_init(&coalesce_stats);
 
     pthread_t threads[config.num_threads];
     MT24110_ThreadData thread_data[config.num_threads];
@@ -133,6 +255,9 @@ int main(int argc, char *argv[]) {
         sock_fds[i] = socket(AF_INET, SOCK_STREAM, 0);
         MT24110_CHECK_NULL((void *)(intptr_t)sock_fds[i], "socket failed");
 
+        /* Buffer sizes must be set before connect() to affect window scaling */
+        mt24110_sockopt_apply_buffers(sock_fds[i], &sock_profile);
+
         struct sockaddr_in server_addr;
         memset(&server_addr, 0, sizeof(server_addr));
         server_addr.sin_family = AF_INET;
@@ -152,6 +277,10 @@ int main(int argc, char *argv[]) {
         int flag = 1;
         setsockopt(sock_fds[i], IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
 
+        /* Socket profile may override Nagle and adds the other tunables */
+        mt24110_sockopt_apply(sock_fds[i], &sock_profile);
+        mt24110_telemetry_register(sock_fds[i]);
+
         thread_data[i].thread_id = i;
         thread_data[i].sock_fd = sock_fds[i];
         thread_data[i].bytes_sent = 0;
@@ -159,9 +288,22 @@ int main(int argc, char *argv[]) {
         thread_data[i].messages_sent = 0;
         thread_data[i].messages_received = 0;
         thread_data[i].total_latency_us = 0;
+        memset(&thread_data[i].buckets, 0, sizeof(thread_data[i].buckets));
+        memset(&thread_data[i].codec, 0, sizeof(thread_data[i].codec));
+        memset(&thread_data[i].coalesce, 0, sizeof(thread_data[i].coalesce));
+        memset(&thread_data[i].paths, 0, sizeof(thread_data[i].paths));
     }
 
+    /* Record what the kernel actually applied and flag sockets that differ */
+    sock_differing = mt24110_sockopt_read_all(sock_fds, config.num_threads, &sock_effective);
+
     /* Start worker threads */
+    struct timespec run_start, run_end;
+    clock_gettime(CLOCK_MONOTONIC, &run_start);
+    mt24110_telemetry_start(config.telemetry_ms);
+    if (mt24110_msgtrace_start(config.msg_trace, 0) < 0) {
+        return EXIT_FAILURE;
+    }
     for (int i = 0; i < config.num_threads; i++) {
         if (pthread_create(&threads[i], NULL, mt24110_worker_thread, &thread_data[i]) != 0) {
             perror("pthread_create failed");
@@ -169,15 +311,23 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    /* Run for specified duration */
-    sleep(config.duration_sec);
+    /* Run for specified duration (or until Ctrl+C), then wake every worker */
+    mt24110_wait_shutdown(config.duration_sec * 1000);
+    clock_gettime(CLOCK_MONOTONIC, &run_end);
     config.running = 0;
+    mt24110_shutdown_trigger();
+    mt24110_telemetry_stop();
 
-    /* Wait for threads to finish */
+    /* Wait for threads to drain in-flight echoes and finish */
     for (int i = 0; i < config.num_threads; i++) {
-        pthread_join(threads[i], NULL);
+        if (mt24110_join_drain(threads[i]) != 0) {
+            /* Still blocked in recv()/send() after --drain-ms: cut it off */
+            shutdown(sock_fds[i], SHUT_RDWR);
+            pthread_join(threads[i], NULL);
+        }
         close(sock_fds[i]);
     }
+    mt24110_msgtrace_stop();
 
     /* Print results */
     long bs = atomic_load(&client_stats.bytes_sent);
@@ -186,7 +336,8 @@ int main(int argc, char *argv[]) {
     long mr = atomic_load(&client_stats.messages_received);
     long tl = atomic_load(&client_stats.total_latency_us);
 
-    double duration = (double)config.duration_sec;
+    double duration = (run_end.tv_sec - run_start.tv_sec) +
+                      (run_end.tv_nsec - run_start.tv_nsec) / 1e9;
     double throughput_gbps = (bs * 8.0) / (duration * 1e9);
     double avg_latency_us = (mr > 0) ? (double)tl / mr : 0;
 
@@ -198,6 +349,23 @@ int main(int argc, char *argv[]) {
     printf("Messages received: %ld\n", mr);
     printf("Throughput: %.4f Gbps\n", throughput_gbps);
     printf("Average latency: %.2f us\n", avg_latency_us);
+    mt24110_sockopt_print(&sock_profile, &sock_effective, config.num_threads, sock_differing);
+    mt24110_telemetry_print();
+    mt24110_msgtrace_print();
+    if (config.telemetry_out != NULL) {
+        mt24110_telemetry_write_csv(config.telemetry_out);
+    }
+
+    if (config.size_dist != NULL) {
+        mt24110_bucket_stats_print(&client_buckets, duration);
+    }
+    if (codec.enabled) {
+        mt24110_codec_stats_print(&codec_stats, &codec, duration, config.num_threads);
+    }
+    if (coalesce.enabled) {
+        mt24110_coalesce_stats_print(&coalesce_stats, &coalesce);
+    }
+    mt24110_size_dist_free(&size_dist);
 
     return EXIT_SUCCESS;
 }
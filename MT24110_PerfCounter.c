@@ -0,0 +1,52 @@
+/*
+ * MT24110_PerfCounter.c
+ * Minimal perf_event_open() wrapper for in-process microbenchmarks
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_PerfCounter.h"
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+/*
+ * Open a disabled counter for the calling thread on any CPU.
+ * user_only excludes kernel and hypervisor time.
+ * Returns the counter fd, or -1 if unavailable.
+ */
+int mt24110_perf_open(uint32_t type, uint64_t config, int user_only) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = user_only ? 1 : 0;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void mt24110_perf_start(int fd) {
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+/*
+ * Disable the counter and return its value, -1 if unavailable
+ */
+long long mt24110_perf_stop(int fd) {
+    if (fd < 0) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+    long long value;
+    if (read(fd, &value, sizeof(value)) != sizeof(value)) return -1;
+    return value;
+}
+
+void mt24110_perf_close(int fd) {
+    if (fd >= 0) close(fd);
+}
@@ -0,0 +1,25 @@
+/*
+ * MT24110_PerfCounter.h
+ * Minimal perf_event_open() wrapper for in-process microbenchmarks
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * Counters are per calling thread. When the kernel refuses a counter
+ * (perf_event_paranoid, containers, VMs) open returns -1 and reads
+ * report -1, so benchmarks still run and print "n/a".
+ */
+
+#ifndef MT24110_PERFCOUNTER_H
+#define MT24110_PERFCOUNTER_H
+
+#include <stdint.h>
+#include <linux/perf_event.h>
+
+/* Function prototypes */
+int mt24110_perf_open(uint32_t type, uint64_t config, int user_only);
+void mt24110_perf_start(int fd);
+long long mt24110_perf_stop(int fd);
+void mt24110_perf_close(int fd);
+
+#endif /* MT24110_PERFCOUNTER_H */
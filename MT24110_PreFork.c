@@ -0,0 +1,532 @@
+/*
+ * MT24110_PreFork.c
+ * Multi-process server mode: a supervisor and pre-forked worker processes
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#define _GNU_SOURCE
+#include "MT24110_PreFork.h"
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define MT24110_PREFORK_BACKLOG 128
+#define MT24110_PREFORK_MAX_EVENTS 64
+#define MT24110_PREFORK_REAP_MS 100
+
+/* One worker's counters, on its own cache lines of the shared segment */
+typedef struct {
+    atomic_int pid;
+    atomic_long connections;
+    atomic_long restarts;
+    atomic_long buffers;        /* message buffers the pool allocated */
+    atomic_uint checksum;       /* sum of closed connections' handler checksums */
+    MT24110_Stats stats;
+    MT24110_FlowCounters flow;  /* published after every event, written by the worker only */
+} __attribute__((aligned(64))) MT24110_PreForkSlot;
+
+/* MAP_SHARED between the supervisor and every worker */
+typedef struct {
+    atomic_int sockopt_claimed;
+    atomic_int sockopt_valid;
+    atomic_int sockopt_checked;     /* connections whose options were read back */
+    atomic_int sockopt_differing;   /* ... and differed from sock_effective */
+    MT24110_SockOptProfile sock_effective;
+    MT24110_PreForkSlot slots[];
+} MT24110_PreForkShared;
+
+/* Free list of message_size buffers, private to one worker */
+typedef struct {
+    char **free_list;
+    int count;
+    int capacity;
+    int size;
+} MT24110_BufferPool;
+
+typedef struct {
+    int fd;
+    char *buffer;
+    MT24110_OutQueue out;       /* echo bytes the socket has not taken yet */
+    uint32_t events;            /* current epoll interest */
+    uint32_t checksum;          /* handler checksum over this connection */
+    uint32_t published_checksum;    /* part of checksum already in the slot */
+    MT24110_FlowCounters published; /* part of out.counters already in the slot */
+    char peer[INET_ADDRSTRLEN + 8];
+} MT24110_PreForkConn;
+
+static char *mt24110_buffer_get(MT24110_BufferPool *pool, MT24110_PreForkSlot *slot) {
+    if (pool->count > 0) {
+        return pool->free_list[--pool->count];
+    }
+    char *buffer = malloc(pool->size);
+    MT24110_CHECK_NULL(buffer, "malloc pool buffer");
+    atomic_fetch_add_explicit(&slot->buffers, 1, memory_order_relaxed);
+    return buffer;
+}
+
+static void mt24110_buffer_put(MT24110_BufferPool *pool, char *buffer) {
+    if (pool->count == pool->capacity) {
+        pool->capacity = pool->capacity ? pool->capacity * 2 : 16;
+        pool->free_list = realloc(pool->free_list, pool->capacity * sizeof(char *));
+        MT24110_CHECK_NULL(pool->free_list, "realloc buffer pool");
+    }
+    pool->free_list[pool->count++] = buffer;
+}
+
+static void mt24110_buffer_pool_destroy(MT24110_BufferPool *pool) {
+    for (int i = 0; i < pool->count; i++) {
+        free(pool->free_list[i]);
+    }
+    free(pool->free_list);
+}
+
+/* Bound, listening, non-blocking socket; -1 on failure */
+static int mt24110_prefork_listen(const MT24110_ServerConfig *config,
+                                  const MT24110_SockOptProfile *profile) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket creation failed");
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (config->reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("SO_REUSEPORT");
+        close(fd);
+        return -1;
+    }
+
+    /* Accepted sockets inherit buffer sizes set before listen() */
+    mt24110_sockopt_apply_buffers(fd, profile);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(config->port);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind failed");
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, MT24110_PREFORK_BACKLOG) < 0) {
+        perror("listen failed");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * One readiness event on a connection: flush queued echoes, then receive
+ * a chunk, process it and echo it, queueing what the socket does not
+ * take. The epoll interest follows the queue: EPOLLIN while reading is
+ * allowed, EPOLLOUT while bytes are pending.
+ * Returns 0 to keep the connection, -1 to close it.
+ */
+static int mt24110_prefork_serve(int epfd, MT24110_PreForkConn *conn, MT24110_PreForkSlot *slot,
+                                 const MT24110_Handler *handler, int message_size,
+                                 const MT24110_FlowConfig *flow) {
+    if (mt24110_outq_pending(&conn->out) > 0) {
+        int flushed = mt24110_outq_flush(&conn->out, conn->fd, flow);
+        if (flushed < 0) {
+            if (errno != EPIPE && errno != ECONNRESET) perror("send failed");
+            return -1;
+        }
+        atomic_fetch_add_explicit(&slot->stats.bytes_sent, flushed, memory_order_relaxed);
+    }
+
+    if (mt24110_outq_can_read(&conn->out)) {
+        int received = recv(conn->fd, conn->buffer, message_size, MSG_DONTWAIT);
+        if (received == 0) {
+            printf("Client %s disconnected\n", conn->peer);
+            return -1;
+        }
+        if (received < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                if (errno != ECONNRESET) perror("recv failed");
+                return -1;
+            }
+        } else {
+            atomic_fetch_add_explicit(&slot->stats.bytes_received, received, memory_order_relaxed);
+            atomic_fetch_add_explicit(&slot->stats.messages_received, 1, memory_order_relaxed);
+
+            /* Processing stage always runs to completion in the worker process */
+            int reply_len = handler->fn(conn->buffer, received, &conn->checksum);
+
+            int sent = mt24110_outq_send(&conn->out, conn->fd, conn->buffer, reply_len, flow);
+            if (sent < 0) {
+                if (errno != EPIPE && errno != ECONNRESET) perror("send failed");
+                return -1;
+            }
+            atomic_fetch_add_explicit(&slot->stats.bytes_sent, sent, memory_order_relaxed);
+            atomic_fetch_add_explicit(&slot->stats.messages_sent, 1, memory_order_relaxed);
+        }
+    }
+
+    uint32_t events = (mt24110_outq_can_read(&conn->out) ? EPOLLIN : 0) |
+                      (mt24110_outq_pending(&conn->out) > 0 ? EPOLLOUT : 0);
+    if (events != conn->events) {
+        struct epoll_event ev = { .events = events, .data.ptr = conn };
+        epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+        conn->events = events;
+    }
+    return 0;
+}
+
+/* Accept every pending connection on the listener */
+static void mt24110_prefork_accept(int epfd, int listen_fd, MT24110_PreForkShared *shared,
+                                   MT24110_PreForkSlot *slot, MT24110_BufferPool *pool,
+                                   const MT24110_SockOptProfile *profile, int *active) {
+    for (;;) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int client_fd = accept4(listen_fd, (struct sockaddr *)&client_addr, &client_len,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            /* EAGAIN: drained, or another worker took it first */
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept failed");
+            return;
+        }
+
+        MT24110_PreForkConn *conn = calloc(1, sizeof(MT24110_PreForkConn));
+        MT24110_CHECK_NULL(conn, "malloc connection");
+        conn->fd = client_fd;
+        conn->buffer = mt24110_buffer_get(pool, slot);
+        mt24110_outq_init(&conn->out);
+        conn->events = EPOLLIN;
+        snprintf(conn->peer, sizeof(conn->peer), "%s:%d",
+                 inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+        printf("Client connected from %s (worker pid %d)\n", conn->peer, (int)getpid());
+
+        mt24110_sockopt_apply(client_fd, profile);
+
+        /*
+         * The first worker to get a connection records the effective
+         * options; later connections (in any worker) are compared with them
+         */
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&shared->sockopt_claimed, &expected, 1)) {
+            mt24110_sockopt_read(client_fd, &shared->sock_effective);
+            mt24110_sockopt_print(profile, &shared->sock_effective, 1, 0);
+            atomic_fetch_add(&shared->sockopt_checked, 1);
+            atomic_store(&shared->sockopt_valid, 1);
+        } else if (atomic_load(&shared->sockopt_valid)) {
+            atomic_fetch_add(&shared->sockopt_checked, 1);
+            if (mt24110_sockopt_compare(client_fd, &shared->sock_effective)) {
+                atomic_fetch_add(&shared->sockopt_differing, 1);
+            }
+        }
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
+            perror("epoll_ctl failed");
+            mt24110_buffer_put(pool, conn->buffer);
+            close(client_fd);
+            free(conn);
+            continue;
+        }
+        atomic_fetch_add_explicit(&slot->connections, 1, memory_order_relaxed);
+        (*active)++;
+    }
+}
+
+/*
+ * Fold what the connection counted since the last event into the slot,
+ * so a worker that crashes loses at most the event in progress
+ */
+static void mt24110_prefork_publish(MT24110_PreForkConn *conn, MT24110_PreForkSlot *slot) {
+    mt24110_flow_counters_publish(&slot->flow, &conn->out.counters, &conn->published);
+    if (conn->checksum != conn->published_checksum) {
+        atomic_fetch_add_explicit(&slot->checksum, conn->checksum - conn->published_checksum,
+                                  memory_order_relaxed);
+        conn->published_checksum = conn->checksum;
+    }
+}
+
+static void mt24110_prefork_close(MT24110_PreForkConn *conn, MT24110_PreForkSlot *slot,
+                                  MT24110_BufferPool *pool, int *active) {
+    close(conn->fd);    /* also removes it from the epoll set */
+    mt24110_outq_free(&conn->out);
+    mt24110_prefork_publish(conn, slot);
+    mt24110_buffer_put(pool, conn->buffer);
+    free(conn);
+    (*active)--;
+}
+
+/* Worker signal handler: stop accepting, drain, exit */
+static void mt24110_prefork_worker_signal(int sig) {
+    (void)sig;
+    mt24110_shutdown_trigger();
+}
+
+/*
+ * Worker process main loop. Never returns. listen_fd is the inherited
+ * listener, or -1 to open a SO_REUSEPORT one.
+ */
+static void mt24110_prefork_worker(const MT24110_ServerConfig *config, const MT24110_Handler *handler,
+                                   const MT24110_SockOptProfile *profile, const MT24110_FlowConfig *flow,
+                                   MT24110_PreForkShared *shared, int index, int listen_fd) {
+    MT24110_PreForkSlot *slot = &shared->slots[index];
+    int active = 0;
+
+    /* Line-buffered so a crashing worker loses no log lines */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    /* Own shutdown eventfd; signals were blocked across fork() */
+    mt24110_shutdown_init(config->drain_ms);
+    mt24110_install_signal_handler(mt24110_prefork_worker_signal);
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+
+    if (listen_fd < 0) {
+        listen_fd = mt24110_prefork_listen(config, profile);
+        if (listen_fd < 0) exit(EXIT_FAILURE);
+    }
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        perror("epoll_create1 failed");
+        exit(EXIT_FAILURE);
+    }
+
+    /* A shared listener wakes one worker per connection, not all of them */
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (!config->reuseport) ev.events |= EPOLLEXCLUSIVE;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+        perror("epoll_ctl listener failed");
+        exit(EXIT_FAILURE);
+    }
+
+    /* The shutdown eventfd is one more source in the set, tagged by this address */
+    static char shutdown_tag;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &shutdown_tag;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, mt24110_shutdown_fd(), &ev) < 0) {
+        perror("epoll_ctl shutdown eventfd failed");
+        exit(EXIT_FAILURE);
+    }
+
+    MT24110_BufferPool pool = { NULL, 0, 0, config->message_size };
+    struct epoll_event events[MT24110_PREFORK_MAX_EVENTS];
+
+    for (;;) {
+        /* Until shutdown wait for anything; afterwards drain for --drain-ms */
+        int n = epoll_wait(epfd, events, MT24110_PREFORK_MAX_EVENTS,
+                           (listen_fd < 0) ? mt24110_drain_remaining_ms() : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait failed");
+            break;
+        }
+        if (n == 0) break;      /* drain deadline passed */
+
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+            if (tag == &shutdown_tag) {
+                /* Stays readable: deregister it, and the listener other processes still hold */
+                epoll_ctl(epfd, EPOLL_CTL_DEL, mt24110_shutdown_fd(), NULL);
+                epoll_ctl(epfd, EPOLL_CTL_DEL, listen_fd, NULL);
+                close(listen_fd);
+                listen_fd = -1;
+            } else if (tag == NULL) {
+                if (listen_fd >= 0) {
+                    mt24110_prefork_accept(epfd, listen_fd, shared, slot, &pool, profile, &active);
+                }
+            } else if (mt24110_prefork_serve(epfd, tag, slot, handler, config->message_size, flow) < 0) {
+                mt24110_prefork_close(tag, slot, &pool, &active);
+            } else {
+                mt24110_prefork_publish(tag, slot);
+            }
+        }
+        if (listen_fd < 0 && active == 0) break;
+    }
+
+    /* Connections still open here are cut off by exit() */
+    mt24110_buffer_pool_destroy(&pool);
+    close(epfd);
+    fflush(stdout);
+    exit(EXIT_SUCCESS);
+}
+
+/* Fork the worker for a slot with termination signals held off */
+static pid_t mt24110_prefork_spawn(const MT24110_ServerConfig *config, const MT24110_Handler *handler,
+                                   const MT24110_SockOptProfile *profile, const MT24110_FlowConfig *flow,
+                                   MT24110_PreForkShared *shared, int index, int listen_fd) {
+    sigset_t mask, old;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, &old);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        mt24110_prefork_worker(config, handler, profile, flow, shared, index, listen_fd);
+    }
+    if (pid < 0) {
+        perror("fork failed");
+    } else {
+        atomic_store(&shared->slots[index].pid, pid);
+    }
+
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return pid;
+}
+
+/* Collect exited workers; respawn them unless the server is stopping */
+static int mt24110_prefork_reap(const MT24110_ServerConfig *config, const MT24110_Handler *handler,
+                                const MT24110_SockOptProfile *profile, const MT24110_FlowConfig *flow,
+                                MT24110_PreForkShared *shared, int listen_fd, int options) {
+    int status, reaped = 0;
+    pid_t pid;
+
+    for (;;) {
+        pid = waitpid(-1, &status, options);
+        if (pid < 0 && errno == EINTR) continue;
+        if (pid <= 0) break;
+        reaped++;
+        int index = -1;
+        for (int i = 0; i < config->prefork; i++) {
+            if (atomic_load(&shared->slots[i].pid) == pid) index = i;
+        }
+        if (index < 0) continue;
+        atomic_store(&shared->slots[index].pid, 0);
+
+        if (mt24110_shutdown_requested()) continue;
+
+        if (WIFSIGNALED(status)) {
+            printf("Worker %d (pid %d) killed by signal %d, respawning\n",
+                   index, (int)pid, WTERMSIG(status));
+        } else {
+            printf("Worker %d (pid %d) exited with status %d, respawning\n",
+                   index, (int)pid, WEXITSTATUS(status));
+        }
+        atomic_fetch_add(&shared->slots[index].restarts, 1);
+        mt24110_prefork_spawn(config, handler, profile, flow, shared, index, listen_fd);
+    }
+    return reaped;
+}
+
+static void mt24110_prefork_print(const MT24110_ServerConfig *config, MT24110_PreForkShared *shared,
+                                  const MT24110_SockOptProfile *profile,
+                                  const MT24110_FlowConfig *flow) {
+    MT24110_Stats total;
+    mt24110_init_stats(&total);
+    MT24110_FlowCounters flow_total;
+    memset(&flow_total, 0, sizeof(flow_total));
+    long connections = 0;
+    uint32_t checksum = 0;
+
+    printf("\n=== Pre-fork Workers ===\n");
+    printf("%-7s %12s %14s %14s %9s %9s\n", "worker", "connections", "msgs_received",
+           "bytes_sent", "buffers", "restarts");
+    for (int i = 0; i < config->prefork; i++) {
+        MT24110_PreForkSlot *slot = &shared->slots[i];
+        long conns = atomic_load(&slot->connections);
+        printf("%-7d %12ld %14ld %14ld %9ld %9ld\n", i, conns,
+               atomic_load(&slot->stats.messages_received), atomic_load(&slot->stats.bytes_sent),
+               atomic_load(&slot->buffers), atomic_load(&slot->restarts));
+
+        connections += conns;
+        atomic_fetch_add(&total.bytes_received, atomic_load(&slot->stats.bytes_received));
+        atomic_fetch_add(&total.bytes_sent, atomic_load(&slot->stats.bytes_sent));
+        atomic_fetch_add(&total.messages_received, atomic_load(&slot->stats.messages_received));
+        atomic_fetch_add(&total.messages_sent, atomic_load(&slot->stats.messages_sent));
+        mt24110_flow_counters_add(&flow_total, &slot->flow);
+        checksum += atomic_load(&slot->checksum);
+    }
+
+    printf("\nConnections served: %ld\n", connections);
+    mt24110_print_stats(&total);
+    if (strcmp(config->handler, "checksum") == 0) {
+        printf("Payload checksum (sum of per-chunk FNV-1a): 0x%08x\n", checksum);
+    }
+    if (atomic_load(&shared->sockopt_valid)) {
+        mt24110_sockopt_print(profile, &shared->sock_effective,
+                              atomic_load(&shared->sockopt_checked),
+                              atomic_load(&shared->sockopt_differing));
+    }
+    mt24110_flow_print(&flow_total, flow);
+}
+
+/*
+ * Supervisor: create the shared segment (and listener), fork the workers,
+ * respawn crashed ones until shutdown, then stop and reap every worker
+ * and print the aggregated statistics. Returns the process exit status.
+ */
+int mt24110_prefork_run(const MT24110_ServerConfig *config, const MT24110_Handler *handler,
+                        const MT24110_SockOptProfile *profile,
+                        const MT24110_FlowConfig *flow) {
+    if (config->handoff) {
+        fprintf(stderr, "--dispatch=handoff is not supported with --prefork\n");
+        return EXIT_FAILURE;
+    }
+    if (config->telemetry_ms > 0) {
+        fprintf(stderr, "--telemetry is not supported with --prefork\n");
+        return EXIT_FAILURE;
+    }
+    if (config->msg_trace != NULL) {
+        fprintf(stderr, "--msg-trace is not supported with --prefork\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t shared_size = sizeof(MT24110_PreForkShared) +
+                         config->prefork * sizeof(MT24110_PreForkSlot);
+    MT24110_PreForkShared *shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap shared stats failed");
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < config->prefork; i++) {
+        mt24110_init_stats(&shared->slots[i].stats);
+    }
+
+    int listen_fd = -1;
+    if (!config->reuseport) {
+        listen_fd = mt24110_prefork_listen(config, profile);
+        if (listen_fd < 0) return EXIT_FAILURE;
+    }
+
+    printf("Pre-fork server listening on port %d\n", config->port);
+    printf("Message size: %d bytes\n", config->message_size);
+    printf("Handler: %s, %d worker processes, %s\n", handler->name, config->prefork,
+           config->reuseport ? "SO_REUSEPORT listener per worker" : "shared listener");
+
+    for (int i = 0; i < config->prefork; i++) {
+        if (mt24110_prefork_spawn(config, handler, profile, flow, shared, i, listen_fd) < 0) {
+            mt24110_shutdown_trigger();
+            break;
+        }
+    }
+
+    /* Supervise until Ctrl+C / SIGTERM */
+    while (!mt24110_shutdown_requested()) {
+        mt24110_wait_shutdown(MT24110_PREFORK_REAP_MS);
+        mt24110_prefork_reap(config, handler, profile, flow, shared, listen_fd, WNOHANG);
+    }
+
+    /* Workers stop accepting and drain; wait for all of them */
+    if (listen_fd >= 0) close(listen_fd);
+    for (int i = 0; i < config->prefork; i++) {
+        pid_t pid = atomic_load(&shared->slots[i].pid);
+        if (pid > 0) kill(pid, SIGTERM);
+    }
+    printf("Draining workers (up to %d ms)\n", config->drain_ms);
+    while (mt24110_prefork_reap(config, handler, profile, flow, shared, listen_fd, 0) > 0) {
+    }
+
+    mt24110_prefork_print(config, shared, profile, flow);
+    munmap(shared, shared_size);
+    printf("Server shutdown complete\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,38 @@
+/*
+ * MT24110_PreFork.h
+ * Multi-process server mode: a supervisor and pre-forked worker processes
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * With --prefork=N the server process becomes a supervisor that forks N
+ * workers. Each worker runs its own epoll loop over non-blocking sockets
+ * and keeps message buffers in a per-process pool, so a crash or
+ * allocator contention stays inside one process. Connections arrive on:
+ *   --listener=shared     one listener created before fork and inherited
+ *                         (EPOLLEXCLUSIVE wakes one worker per connection)
+ *   --listener=reuseport  one SO_REUSEPORT listener per worker, the kernel
+ *                         spreads connections by hash
+ * The supervisor respawns workers that die while the server is running.
+ * Workers count into their slot of a MAP_SHARED segment, so the totals
+ * survive crashes and are printed by the supervisor at shutdown. Flow
+ * and checksum counters of open connections are published to the slot
+ * after every event; a crash loses only the event in progress and the
+ * throttled time of a connection still above its high watermark.
+ * Echoes that a client does not read yet wait in the connection's output
+ * queue; the connection keeps being read until --high-water (MT24110_Flow.h).
+ */
+
+#ifndef MT24110_PREFORK_H
+#define MT24110_PREFORK_H
+
+#include "MT24110_Common.h"
+#include "MT24110_WorkerPool.h"
+#include "MT24110_SockOpt.h"
+#include "MT24110_Flow.h"
+
+/* Function prototypes */
+int mt24110_prefork_run(const MT24110_ServerConfig *config, const MT24110_Handler *handler,
+                        const MT24110_SockOptProfile *profile, const MT24110_FlowConfig *flow);
+
+#endif /* MT24110_PREFORK_H */
@@ -0,0 +1,506 @@
+/*
+ * MT24110_Ring.h
+ * Header-only lock-free SPSC and MPSC ring buffers
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * Bounded queues for handing items between threads, instantiated per
+ * element type with a macro:
+ *
+ *   MT24110_SPSC_RING_DEFINE(MT24110_JobRing, mt24110_job_ring, MT24110_Job *)
+ *
+ * defines the type MT24110_JobRing and mt24110_job_ring_init/destroy/
+ * push/pop/push_batch/pop_batch/push_wait/pop_wait/close/poll_prepare/
+ * poll_done. MT24110_MPSC_RING_DEFINE does the same for many producers
+ * and one consumer, MT24110_MPMC_RING_DEFINE for many of both. Pointer
+ * rings of all three kinds are predefined below.
+ *
+ * Layout: producer index, consumer index, read-only fields and the two
+ * wait words each sit on their own cache line, so the producer and the
+ * consumer only share a line when one actually has to look at the
+ * other's index. The SPSC ring keeps a cached copy of the other side's
+ * index (Lamport queue with cached indices). The MPSC ring stamps every
+ * slot with a sequence number; producers claim slots with one CAS on the
+ * head (a batch claims several at once) and publish each slot
+ * separately. The MPMC ring (Vyukov) uses the same slots and lets
+ * consumers claim them with a CAS on the tail.
+ *
+ * Non-blocking push/pop return how many items moved. Whether a ring can
+ * be slept on is fixed at _init: only a blocking ring pays for the full
+ * fence and the sleeper check on every push and pop. On a blocking ring
+ * the _wait variants spin briefly, then sleep on a futex; the other side
+ * only issues a wake syscall when someone is actually asleep. A consumer
+ * that polls sockets can instead register an eventfd
+ * (mt24110_ring_set_eventfd), arm it with _poll_prepare and add it to its
+ * poll set. On a non-blocking ring the _wait variants yield instead of
+ * sleeping and the eventfd is never signalled.
+ *
+ * Rings contain over-aligned members: declare them static, on the stack
+ * or allocate them with aligned_alloc(MT24110_CACHE_LINE, ...).
+ */
+
+#ifndef MT24110_RING_H
+#define MT24110_RING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define MT24110_CACHE_LINE 64
+
+/* Polls of the ring before a _wait call goes to sleep */
+#define MT24110_RING_SPINS 256
+
+/* Last argument of _init */
+#define MT24110_RING_NONBLOCKING 0
+#define MT24110_RING_BLOCKING 1
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MT24110_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define MT24110_CPU_RELAX() __asm__ volatile("yield" ::: "memory")
+#else
+#define MT24110_CPU_RELAX() __asm__ volatile("" ::: "memory")
+#endif
+
+/* Futex word plus sleeper count: wakes cost a syscall only when needed */
+typedef struct {
+    atomic_uint seq;            /* bumped on every wake, the futex word */
+    atomic_int sleepers;
+    int efd;                    /* >= 0: also signalled for poll()-based waiters */
+} MT24110_RingWaiter;
+
+/* Type-independent part of every ring */
+typedef struct {
+    _Alignas(MT24110_CACHE_LINE) atomic_size_t head;   /* next slot to fill */
+    size_t cached_tail;         /* SPSC: producer's last view of tail */
+    _Alignas(MT24110_CACHE_LINE) atomic_size_t tail;   /* next slot to drain */
+    size_t cached_head;         /* SPSC: consumer's last view of head */
+    _Alignas(MT24110_CACHE_LINE) size_t capacity;      /* power of two */
+    size_t mask;
+    int blocking;               /* fixed at init: publishes wake sleepers */
+    atomic_int closed;
+    _Alignas(MT24110_CACHE_LINE) MT24110_RingWaiter not_empty;
+    _Alignas(MT24110_CACHE_LINE) MT24110_RingWaiter not_full;
+} MT24110_RingIndex;
+
+static inline void mt24110_ring_index_init(MT24110_RingIndex *idx, size_t capacity, int blocking) {
+    size_t cap = 2;
+    while (cap < capacity) cap <<= 1;
+
+    atomic_init(&idx->head, 0);
+    atomic_init(&idx->tail, 0);
+    idx->cached_tail = 0;
+    idx->cached_head = 0;
+    idx->capacity = cap;
+    idx->mask = cap - 1;
+    idx->blocking = blocking;
+    atomic_init(&idx->closed, 0);
+    atomic_init(&idx->not_empty.seq, 0);
+    atomic_init(&idx->not_empty.sleepers, 0);
+    idx->not_empty.efd = -1;
+    atomic_init(&idx->not_full.seq, 0);
+    atomic_init(&idx->not_full.sleepers, 0);
+    idx->not_full.efd = -1;
+}
+
+/* Register as a sleeper; returns the futex value to wait on */
+static inline unsigned mt24110_waiter_prepare(MT24110_RingWaiter *w) {
+    atomic_fetch_add(&w->sleepers, 1);
+    /* Pairs with the fence in mt24110_waiter_wake: we see the item or it sees us */
+    atomic_thread_fence(memory_order_seq_cst);
+    return atomic_load(&w->seq);
+}
+
+static inline void mt24110_waiter_cancel(MT24110_RingWaiter *w) {
+    atomic_fetch_sub(&w->sleepers, 1);
+}
+
+static inline void mt24110_waiter_sleep(MT24110_RingWaiter *w, unsigned seq) {
+    syscall(SYS_futex, &w->seq, FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+}
+
+/* Called after publishing: wake sleepers, if there are any */
+static inline void mt24110_waiter_wake(MT24110_RingWaiter *w) {
+    /* Orders the publishing store before the sleepers load */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&w->sleepers, memory_order_relaxed) == 0) return;
+
+    atomic_fetch_add(&w->seq, 1);
+    syscall(SYS_futex, &w->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    if (w->efd >= 0) {
+        uint64_t one = 1;
+        ssize_t n = write(w->efd, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+/* After a push or pop: a non-blocking ring has no sleepers to look for */
+static inline void mt24110_ring_publish(MT24110_RingIndex *idx, MT24110_RingWaiter *w) {
+    if (idx->blocking) mt24110_waiter_wake(w);
+}
+
+/*
+ * Signal efd (EFD_NONBLOCK) when items arrive for a consumer armed with
+ * _poll_prepare; blocking rings only
+ */
+static inline void mt24110_ring_set_eventfd(MT24110_RingIndex *idx, int efd) {
+    idx->not_empty.efd = efd;
+}
+
+/* Wake every waiter; _wait calls return 0 once the ring is drained */
+static inline void mt24110_ring_index_close(MT24110_RingIndex *idx) {
+    atomic_store(&idx->closed, 1);
+    /* A permanent extra sleeper: every later publish wakes too */
+    atomic_fetch_add(&idx->not_empty.sleepers, 1);
+    atomic_fetch_add(&idx->not_full.sleepers, 1);
+    mt24110_waiter_wake(&idx->not_empty);
+    mt24110_waiter_wake(&idx->not_full);
+}
+
+static inline size_t mt24110_ring_min(size_t a, size_t b) {
+    return a < b ? a : b;
+}
+
+/*
+ * Blocking wrappers shared by all ring kinds: try, spin, then sleep
+ * until the other side wakes us or the ring is closed.
+ */
+#define MT24110_RING_WAIT_FUNCTIONS(Type, prefix, T)                                \
+static inline int prefix##_push_wait(Type *r, T item) {                            \
+    for (;;) {                                                                      \
+        for (int spin = 0; spin < MT24110_RING_SPINS; spin++) {                     \
+            if (atomic_load_explicit(&r->idx.closed, memory_order_relaxed)) return 0; \
+            if (prefix##_push(r, item)) return 1;                                   \
+            MT24110_CPU_RELAX();                                                    \
+        }                                                                           \
+        if (!r->idx.blocking) {                                                     \
+            sched_yield();                                                          \
+            continue;                                                               \
+        }                                                                           \
+        unsigned seq = mt24110_waiter_prepare(&r->idx.not_full);                    \
+        if (prefix##_full(r) && !atomic_load(&r->idx.closed)) {                     \
+            mt24110_waiter_sleep(&r->idx.not_full, seq);                            \
+        }                                                                           \
+        mt24110_waiter_cancel(&r->idx.not_full);                                    \
+    }                                                                               \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_pop_wait(Type *r, T *item) {                            \
+    for (;;) {                                                                      \
+        for (int spin = 0; spin < MT24110_RING_SPINS; spin++) {                     \
+            if (prefix##_pop(r, item)) return 1;                                    \
+            if (atomic_load_explicit(&r->idx.closed, memory_order_acquire)) {       \
+                return prefix##_pop(r, item);                                       \
+            }                                                                       \
+            MT24110_CPU_RELAX();                                                    \
+        }                                                                           \
+        if (!r->idx.blocking) {                                                     \
+            sched_yield();                                                          \
+            continue;                                                               \
+        }                                                                           \
+        unsigned seq = mt24110_waiter_prepare(&r->idx.not_empty);                   \
+        if (prefix##_empty(r) && !atomic_load(&r->idx.closed)) {                    \
+            mt24110_waiter_sleep(&r->idx.not_empty, seq);                           \
+        }                                                                           \
+        mt24110_waiter_cancel(&r->idx.not_empty);                                   \
+    }                                                                               \
+}                                                                                   \
+                                                                                    \
+/* Arm before poll()ing the eventfd; 0: items are ready, do not sleep */           \
+static inline int prefix##_poll_prepare(Type *r) {                                 \
+    mt24110_waiter_prepare(&r->idx.not_empty);                                      \
+    if (!prefix##_empty(r) || atomic_load(&r->idx.closed)) {                        \
+        mt24110_waiter_cancel(&r->idx.not_empty);                                   \
+        return 0;                                                                   \
+    }                                                                               \
+    return 1;                                                                       \
+}                                                                                   \
+                                                                                    \
+/* After poll() returned for an armed ring: disarm and reset the eventfd */        \
+static inline void prefix##_poll_done(Type *r) {                                   \
+    mt24110_waiter_cancel(&r->idx.not_empty);                                       \
+    uint64_t count;                                                                 \
+    ssize_t n = read(r->idx.not_empty.efd, &count, sizeof(count));                  \
+    (void)n;                                                                        \
+}                                                                                   \
+                                                                                    \
+static inline void prefix##_close(Type *r) {                                       \
+    mt24110_ring_index_close(&r->idx);                                              \
+}
+
+/*
+ * Single producer, single consumer. Each side owns its index and only
+ * reloads the other one when its cached copy says full / empty.
+ */
+#define MT24110_SPSC_RING_DEFINE(Type, prefix, T)                                   \
+typedef struct {                                                                    \
+    MT24110_RingIndex idx;                                                          \
+    T *slots;                                                                       \
+} Type;                                                                             \
+                                                                                    \
+static inline int prefix##_init(Type *r, size_t capacity, int blocking) {          \
+    mt24110_ring_index_init(&r->idx, capacity, blocking);                           \
+    r->slots = aligned_alloc(MT24110_CACHE_LINE,                                    \
+                             (r->idx.capacity * sizeof(T) + MT24110_CACHE_LINE - 1) \
+                             / MT24110_CACHE_LINE * MT24110_CACHE_LINE);            \
+    return r->slots != NULL ? 0 : -1;                                               \
+}                                                                                   \
+                                                                                    \
+static inline void prefix##_destroy(Type *r) {                                     \
+    free(r->slots);                                                                 \
+    r->slots = NULL;                                                                \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_empty(Type *r) {                                        \
+    return atomic_load_explicit(&r->idx.head, memory_order_acquire) ==              \
+           atomic_load_explicit(&r->idx.tail, memory_order_relaxed);                \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_full(Type *r) {                                         \
+    return atomic_load_explicit(&r->idx.head, memory_order_relaxed) -               \
+           atomic_load_explicit(&r->idx.tail, memory_order_acquire) == r->idx.capacity; \
+}                                                                                   \
+                                                                                    \
+static inline size_t prefix##_push_batch(Type *r, T const *items, size_t n) {      \
+    size_t head = atomic_load_explicit(&r->idx.head, memory_order_relaxed);         \
+    size_t free_slots = r->idx.capacity - (head - r->idx.cached_tail);              \
+    if (free_slots < n) {                                                           \
+        r->idx.cached_tail = atomic_load_explicit(&r->idx.tail, memory_order_acquire); \
+        free_slots = r->idx.capacity - (head - r->idx.cached_tail);                 \
+    }                                                                               \
+    size_t k = mt24110_ring_min(n, free_slots);                                     \
+    for (size_t i = 0; i < k; i++) {                                                \
+        r->slots[(head + i) & r->idx.mask] = items[i];                              \
+    }                                                                               \
+    if (k > 0) {                                                                    \
+        atomic_store_explicit(&r->idx.head, head + k, memory_order_release);        \
+        mt24110_ring_publish(&r->idx, &r->idx.not_empty);                                     \
+    }                                                                               \
+    return k;                                                                       \
+}                                                                                   \
+                                                                                    \
+static inline size_t prefix##_pop_batch(Type *r, T *items, size_t n) {             \
+    size_t tail = atomic_load_explicit(&r->idx.tail, memory_order_relaxed);         \
+    size_t ready = r->idx.cached_head - tail;                                       \
+    if (ready < n) {                                                                \
+        r->idx.cached_head = atomic_load_explicit(&r->idx.head, memory_order_acquire); \
+        ready = r->idx.cached_head - tail;                                          \
+    }                                                                               \
+    size_t k = mt24110_ring_min(n, ready);                                          \
+    for (size_t i = 0; i < k; i++) {                                                \
+        items[i] = r->slots[(tail + i) & r->idx.mask];                              \
+    }                                                                               \
+    if (k > 0) {                                                                    \
+        atomic_store_explicit(&r->idx.tail, tail + k, memory_order_release);        \
+        mt24110_ring_publish(&r->idx, &r->idx.not_full);                                      \
+    }                                                                               \
+    return k;                                                                       \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_push(Type *r, T item) {                                 \
+    return prefix##_push_batch(r, &item, 1) == 1;                                   \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_pop(Type *r, T *item) {                                 \
+    return prefix##_pop_batch(r, item, 1) == 1;                                     \
+}                                                                                   \
+                                                                                    \
+MT24110_RING_WAIT_FUNCTIONS(Type, prefix, T)
+
+/*
+ * Rings whose slots carry a sequence number. A slot is free for
+ * position pos when its sequence equals pos and holds an item when it
+ * equals pos + 1; the consumer frees it for the next lap with
+ * pos + capacity. Shared by the MPSC and MPMC rings.
+ */
+#define MT24110_SEQ_RING_COMMON(Type, prefix, T)                                    \
+typedef struct {                                                                    \
+    atomic_size_t seq;                                                              \
+    T value;                                                                        \
+} Type##_Slot;                                                                      \
+                                                                                    \
+typedef struct {                                                                    \
+    MT24110_RingIndex idx;                                                          \
+    Type##_Slot *slots;                                                             \
+} Type;                                                                             \
+                                                                                    \
+static inline int prefix##_init(Type *r, size_t capacity, int blocking) {          \
+    mt24110_ring_index_init(&r->idx, capacity, blocking);                           \
+    r->slots = aligned_alloc(MT24110_CACHE_LINE,                                    \
+                             (r->idx.capacity * sizeof(Type##_Slot) + MT24110_CACHE_LINE - 1) \
+                             / MT24110_CACHE_LINE * MT24110_CACHE_LINE);            \
+    if (r->slots == NULL) return -1;                                                \
+    for (size_t i = 0; i < r->idx.capacity; i++) {                                  \
+        atomic_init(&r->slots[i].seq, i);                                           \
+    }                                                                               \
+    return 0;                                                                       \
+}                                                                                   \
+                                                                                    \
+static inline void prefix##_destroy(Type *r) {                                     \
+    free(r->slots);                                                                 \
+    r->slots = NULL;                                                                \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_empty(Type *r) {                                        \
+    size_t tail = atomic_load_explicit(&r->idx.tail, memory_order_relaxed);         \
+    return atomic_load_explicit(&r->slots[tail & r->idx.mask].seq,                  \
+                                memory_order_acquire) != tail + 1;                  \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_full(Type *r) {                                         \
+    size_t head = atomic_load(&r->idx.head);                                        \
+    size_t tail = atomic_load_explicit(&r->idx.tail, memory_order_acquire);         \
+    return (ptrdiff_t)(head - tail) >= (ptrdiff_t)r->idx.capacity;                  \
+}
+
+/*
+ * Many producers, single consumer. The consumer frees slots in order,
+ * so a producer may claim k slots at once when the consumer's tail
+ * shows k free.
+ */
+#define MT24110_MPSC_RING_DEFINE(Type, prefix, T)                                   \
+MT24110_SEQ_RING_COMMON(Type, prefix, T)                                            \
+                                                                                    \
+static inline size_t prefix##_push_batch(Type *r, T const *items, size_t n) {      \
+    size_t head = atomic_load_explicit(&r->idx.head, memory_order_relaxed);         \
+    size_t k;                                                                       \
+    for (;;) {                                                                      \
+        size_t tail = atomic_load_explicit(&r->idx.tail, memory_order_acquire);     \
+        ptrdiff_t used = (ptrdiff_t)(head - tail);                                  \
+        if (used < 0) {             /* stale head, the consumer is already past */  \
+            head = atomic_load_explicit(&r->idx.head, memory_order_relaxed);        \
+            continue;                                                               \
+        }                                                                           \
+        if ((size_t)used >= r->idx.capacity) return 0;                              \
+        k = mt24110_ring_min(n, r->idx.capacity - used);                            \
+        if (atomic_compare_exchange_weak_explicit(&r->idx.head, &head, head + k,    \
+                                                  memory_order_relaxed,             \
+                                                  memory_order_relaxed)) break;     \
+    }                                                                               \
+    for (size_t i = 0; i < k; i++) {                                                \
+        Type##_Slot *slot = &r->slots[(head + i) & r->idx.mask];                    \
+        slot->value = items[i];                                                     \
+        atomic_store_explicit(&slot->seq, head + i + 1, memory_order_release);      \
+    }                                                                               \
+    mt24110_ring_publish(&r->idx, &r->idx.not_empty);                                         \
+    return k;                                                                       \
+}                                                                                   \
+                                                                                    \
+static inline size_t prefix##_pop_batch(Type *r, T *items, size_t n) {             \
+    size_t tail = atomic_load_explicit(&r->idx.tail, memory_order_relaxed);         \
+    size_t k = 0;                                                                   \
+    for (; k < n; k++) {                                                            \
+        Type##_Slot *slot = &r->slots[(tail + k) & r->idx.mask];                    \
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != tail + k + 1) break; \
+        items[k] = slot->value;                                                     \
+        atomic_store_explicit(&slot->seq, tail + k + r->idx.capacity,               \
+                              memory_order_relaxed);                                \
+    }                                                                               \
+    if (k > 0) {                                                                    \
+        atomic_store_explicit(&r->idx.tail, tail + k, memory_order_release);        \
+        mt24110_ring_publish(&r->idx, &r->idx.not_full);                                      \
+    }                                                                               \
+    return k;                                                                       \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_push(Type *r, T item) {                                 \
+    return prefix##_push_batch(r, &item, 1) == 1;                                   \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_pop(Type *r, T *item) {                                 \
+    return prefix##_pop_batch(r, item, 1) == 1;                                     \
+}                                                                                   \
+                                                                                    \
+MT24110_RING_WAIT_FUNCTIONS(Type, prefix, T)
+
+/*
+ * Many producers, many consumers (Vyukov's bounded queue). Both sides
+ * claim one slot at a time with a CAS on their index and then wait on
+ * nothing but that slot's sequence, so a consumer never sees a slot its
+ * producer has not finished. Batches are single claims in a loop.
+ */
+#define MT24110_MPMC_RING_DEFINE(Type, prefix, T)                                   \
+MT24110_SEQ_RING_COMMON(Type, prefix, T)                                            \
+                                                                                    \
+static inline int prefix##_push_one(Type *r, T item) {                             \
+    size_t pos = atomic_load_explicit(&r->idx.head, memory_order_relaxed);          \
+    Type##_Slot *slot;                                                              \
+    for (;;) {                                                                      \
+        slot = &r->slots[pos & r->idx.mask];                                        \
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);        \
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;                              \
+        if (diff == 0) {                                                            \
+            if (atomic_compare_exchange_weak_explicit(&r->idx.head, &pos, pos + 1,  \
+                                                      memory_order_relaxed,         \
+                                                      memory_order_relaxed)) break; \
+        } else if (diff < 0) {                                                      \
+            return 0;               /* full */                                      \
+        } else {                                                                    \
+            pos = atomic_load_explicit(&r->idx.head, memory_order_relaxed);         \
+        }                                                                           \
+    }                                                                               \
+    slot->value = item;                                                             \
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);               \
+    return 1;                                                                       \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_pop_one(Type *r, T *item) {                             \
+    size_t pos = atomic_load_explicit(&r->idx.tail, memory_order_relaxed);          \
+    Type##_Slot *slot;                                                              \
+    for (;;) {                                                                      \
+        slot = &r->slots[pos & r->idx.mask];                                        \
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);        \
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);                        \
+        if (diff == 0) {                                                            \
+            if (atomic_compare_exchange_weak_explicit(&r->idx.tail, &pos, pos + 1,  \
+                                                      memory_order_relaxed,         \
+                                                      memory_order_relaxed)) break; \
+        } else if (diff < 0) {                                                      \
+            return 0;               /* empty */                                     \
+        } else {                                                                    \
+            pos = atomic_load_explicit(&r->idx.tail, memory_order_relaxed);         \
+        }                                                                           \
+    }                                                                               \
+    *item = slot->value;                                                            \
+    atomic_store_explicit(&slot->seq, pos + r->idx.capacity, memory_order_release); \
+    return 1;                                                                       \
+}                                                                                   \
+                                                                                    \
+static inline size_t prefix##_push_batch(Type *r, T const *items, size_t n) {      \
+    size_t k = 0;                                                                   \
+    while (k < n && prefix##_push_one(r, items[k])) k++;                            \
+    if (k > 0) mt24110_ring_publish(&r->idx, &r->idx.not_empty);                    \
+    return k;                                                                       \
+}                                                                                   \
+                                                                                    \
+static inline size_t prefix##_pop_batch(Type *r, T *items, size_t n) {             \
+    size_t k = 0;                                                                   \
+    while (k < n && prefix##_pop_one(r, &items[k])) k++;                            \
+    if (k > 0) mt24110_ring_publish(&r->idx, &r->idx.not_full);                     \
+    return k;                                                                       \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_push(Type *r, T item) {                                 \
+    return prefix##_push_batch(r, &item, 1) == 1;                                   \
+}                                                                                   \
+                                                                                    \
+static inline int prefix##_pop(Type *r, T *item) {                                 \
+    return prefix##_pop_batch(r, item, 1) == 1;                                     \
+}                                                                                   \
+                                                                                    \
+MT24110_RING_WAIT_FUNCTIONS(Type, prefix, T)
+
+/* Pointer rings, the common case of handing buffers or jobs around */
+MT24110_SPSC_RING_DEFINE(MT24110_SpscRing, mt24110_spsc, void *)
+MT24110_MPSC_RING_DEFINE(MT24110_MpscRing, mt24110_mpsc, void *)
+MT24110_MPMC_RING_DEFINE(MT24110_MpmcRing, mt24110_mpmc, void *)
+
+#endif /* MT24110_RING_H */
@@ -0,0 +1,348 @@
+/*
+ * MT24110_SizeDist.c
+ * Message size distributions, trace replay and per-size-bucket statistics
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_SizeDist.h"
+#include <math.h>
+
+/* Initial capacity for CDF / trace files, grown by doubling */
+#define MT24110_DIST_INITIAL_POINTS 64
+
+/* Rounding tolerated in the final cumulative probability of a CDF file */
+#define MT24110_CDF_EPSILON 1e-6
+
+/* xorshift64* - cheap per-thread generator, no shared state */
+static uint64_t mt24110_rng_next(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/* Uniform double in (0, 1) */
+static double mt24110_rng_uniform(uint64_t *state) {
+    return ((mt24110_rng_next(state) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+static int mt24110_clamp_size(long size, int min_size, int max_size) {
+    if (size < min_size) return min_size;
+    if (size > max_size) return max_size;
+    return (int)size;
+}
+
+/*
+ * Load "<a> <b>" pairs from a text file. Lines starting with '#' are skipped.
+ * For CDF files a = size, b = cumulative probability.
+ * For trace files a = offset in microseconds, b = size.
+ */
+static int mt24110_load_pairs(const char *path, MT24110_SizeDist *dist) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    int capacity = MT24110_DIST_INITIAL_POINTS;
+    dist->sizes = malloc(capacity * sizeof(int));
+    dist->cdf = malloc(capacity * sizeof(double));
+    dist->offsets_us = malloc(capacity * sizeof(long));
+    MT24110_CHECK_NULL(dist->sizes, "malloc dist sizes");
+    MT24110_CHECK_NULL(dist->cdf, "malloc dist cdf");
+    MT24110_CHECK_NULL(dist->offsets_us, "malloc dist offsets");
+
+    char line[256];
+    int n = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        double a, b;
+        if (sscanf(line, "%lf %lf", &a, &b) != 2) {
+            fprintf(stderr, "%s: malformed line: %s", path, line);
+            fclose(fp);
+            return -1;
+        }
+
+        if (n == capacity) {
+            capacity *= 2;
+            dist->sizes = realloc(dist->sizes, capacity * sizeof(int));
+            dist->cdf = realloc(dist->cdf, capacity * sizeof(double));
+            dist->offsets_us = realloc(dist->offsets_us, capacity * sizeof(long));
+            MT24110_CHECK_NULL(dist->sizes, "realloc dist sizes");
+            MT24110_CHECK_NULL(dist->cdf, "realloc dist cdf");
+            MT24110_CHECK_NULL(dist->offsets_us, "realloc dist offsets");
+        }
+
+        if (dist->kind == MT24110_DIST_EMPIRICAL) {
+            dist->sizes[n] = (int)a;
+            dist->cdf[n] = b;
+        } else {
+            dist->offsets_us[n] = (long)a;
+            dist->sizes[n] = (int)b;
+        }
+        if (dist->sizes[n] <= 0) {
+            fprintf(stderr, "%s: size must be positive: %s", path, line);
+            fclose(fp);
+            return -1;
+        }
+        n++;
+    }
+    fclose(fp);
+
+    if (n == 0) {
+        fprintf(stderr, "%s: no data points\n", path);
+        return -1;
+    }
+    dist->num_points = n;
+    return 0;
+}
+
+/*
+ * Parse a distribution spec (see MT24110_SizeDist.h). A NULL or empty
+ * spec means the classic fixed-size workload of default_size bytes.
+ * Returns 0 on success, -1 on a malformed spec, with nothing left
+ * allocated.
+ */
+int mt24110_size_dist_parse(const char *spec, int default_size, MT24110_SizeDist *dist) {
+    memset(dist, 0, sizeof(*dist));
+    dist->kind = MT24110_DIST_FIXED;
+    dist->fixed_size = default_size;
+    dist->min_size = default_size;
+    dist->max_size = default_size;
+
+    if (spec == NULL || spec[0] == '\0') return 0;
+
+    if (strncmp(spec, "fixed:", 6) == 0) {
+        dist->fixed_size = atoi(spec + 6);
+        dist->min_size = dist->fixed_size;
+        dist->max_size = dist->fixed_size;
+    } else if (strncmp(spec, "uniform:", 8) == 0) {
+        dist->kind = MT24110_DIST_UNIFORM;
+        if (sscanf(spec + 8, "%d:%d", &dist->min_size, &dist->max_size) != 2) goto bad_spec;
+    } else if (strncmp(spec, "lognormal:", 10) == 0) {
+        double median;
+        dist->kind = MT24110_DIST_LOGNORMAL;
+        dist->min_size = 1;
+        dist->max_size = default_size;
+        int n = sscanf(spec + 10, "%lf:%lf:%d:%d", &median, &dist->sigma,
+                       &dist->min_size, &dist->max_size);
+        if (n != 2 && n != 4) goto bad_spec;
+        if (median <= 0 || dist->sigma < 0) goto bad_spec;
+        dist->mu = log(median);
+    } else if (strncmp(spec, "cdf:", 4) == 0) {
+        dist->kind = MT24110_DIST_EMPIRICAL;
+        if (mt24110_load_pairs(spec + 4, dist) < 0) goto fail;
+
+        /* CDF must be non-decreasing within [0, 1] and end at 1 */
+        dist->min_size = dist->sizes[0];
+        dist->max_size = dist->sizes[0];
+        for (int i = 0; i < dist->num_points; i++) {
+            if (dist->cdf[i] < 0.0 || dist->cdf[i] > 1.0) {
+                fprintf(stderr, "%s: probability %g outside [0, 1] at line %d\n",
+                        spec + 4, dist->cdf[i], i + 1);
+                goto fail;
+            }
+            if (i > 0 && dist->cdf[i] < dist->cdf[i - 1]) {
+                fprintf(stderr, "%s: CDF is not monotonic at line %d\n", spec + 4, i + 1);
+                goto fail;
+            }
+            if (dist->sizes[i] < dist->min_size) dist->min_size = dist->sizes[i];
+            if (dist->sizes[i] > dist->max_size) dist->max_size = dist->sizes[i];
+        }
+        if (dist->cdf[dist->num_points - 1] < 1.0 - MT24110_CDF_EPSILON) {
+            fprintf(stderr, "%s: CDF ends at %g, expected 1\n",
+                    spec + 4, dist->cdf[dist->num_points - 1]);
+            goto fail;
+        }
+        /* Absorb rounding in the file so every draw finds a point */
+        dist->cdf[dist->num_points - 1] = 1.0;
+    } else if (strncmp(spec, "trace:", 6) == 0) {
+        dist->kind = MT24110_DIST_TRACE;
+        if (mt24110_load_pairs(spec + 6, dist) < 0) goto fail;
+
+        dist->min_size = dist->sizes[0];
+        dist->max_size = dist->sizes[0];
+        for (int i = 0; i < dist->num_points; i++) {
+            if (i > 0 && dist->offsets_us[i] < dist->offsets_us[i - 1]) {
+                fprintf(stderr, "%s: timestamps go backwards at line %d\n", spec + 6, i + 1);
+                goto fail;
+            }
+            if (dist->sizes[i] < dist->min_size) dist->min_size = dist->sizes[i];
+            if (dist->sizes[i] > dist->max_size) dist->max_size = dist->sizes[i];
+        }
+    } else {
+        goto bad_spec;
+    }
+
+    if (dist->min_size <= 0 || dist->max_size < dist->min_size) goto bad_spec;
+    return 0;
+
+bad_spec:
+    fprintf(stderr, "Invalid size distribution: %s\n", spec);
+    fprintf(stderr, "Expected fixed:N | uniform:MIN:MAX | lognormal:MEDIAN:SIGMA[:MIN:MAX] | cdf:FILE | trace:FILE\n");
+
+fail:
+    /* A file that failed validation may have been loaded already */
+    mt24110_size_dist_free(dist);
+    return -1;
+}
+
+/*
+ * Release memory held by CDF / trace distributions
+ */
+void mt24110_size_dist_free(MT24110_SizeDist *dist) {
+    free(dist->sizes);
+    free(dist->cdf);
+    free(dist->offsets_us);
+    dist->sizes = NULL;
+    dist->cdf = NULL;
+    dist->offsets_us = NULL;
+}
+
+const char *mt24110_size_dist_name(const MT24110_SizeDist *dist) {
+    switch (dist->kind) {
+    case MT24110_DIST_FIXED:     return "fixed";
+    case MT24110_DIST_UNIFORM:   return "uniform";
+    case MT24110_DIST_LOGNORMAL: return "lognormal";
+    case MT24110_DIST_EMPIRICAL: return "empirical";
+    case MT24110_DIST_TRACE:     return "trace";
+    }
+    return "unknown";
+}
+
+/*
+ * Initialize a per-thread sampler. Each thread gets its own seed so
+ * threads do not send identical size sequences.
+ */
+void mt24110_sampler_init(MT24110_SizeSampler *sampler, const MT24110_SizeDist *dist, uint64_t seed) {
+    sampler->dist = dist;
+    sampler->rng = seed * 0x9E3779B97F4A7C15ULL + 1;
+    sampler->trace_pos = 0;
+    sampler->trace_base_us = 0;
+}
+
+/*
+ * Draw the next message size. For trace replay *send_at_us receives the
+ * offset (from thread start) at which the message should be sent; the
+ * trace loops when exhausted. For all other kinds it is set to -1.
+ */
+int mt24110_sampler_next(MT24110_SizeSampler *sampler, long *send_at_us) {
+    const MT24110_SizeDist *dist = sampler->dist;
+    *send_at_us = -1;
+
+    switch (dist->kind) {
+    case MT24110_DIST_FIXED:
+        return dist->fixed_size;
+
+    case MT24110_DIST_UNIFORM: {
+        uint64_t span = (uint64_t)(dist->max_size - dist->min_size) + 1;
+        return dist->min_size + (int)(mt24110_rng_next(&sampler->rng) % span);
+    }
+
+    case MT24110_DIST_LOGNORMAL: {
+        /* Box-Muller, one normal deviate per call */
+        double u1 = mt24110_rng_uniform(&sampler->rng);
+        double u2 = mt24110_rng_uniform(&sampler->rng);
+        double z = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+        double size = exp(dist->mu + dist->sigma * z);
+        return mt24110_clamp_size(lround(size), dist->min_size, dist->max_size);
+    }
+
+    case MT24110_DIST_EMPIRICAL: {
+        /* Binary search for first point with cdf >= u */
+        double u = mt24110_rng_uniform(&sampler->rng);
+        int lo = 0, hi = dist->num_points - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (dist->cdf[mid] < u) lo = mid + 1;
+            else hi = mid;
+        }
+        return dist->sizes[lo];
+    }
+
+    case MT24110_DIST_TRACE: {
+        int pos = sampler->trace_pos;
+        *send_at_us = sampler->trace_base_us + dist->offsets_us[pos];
+        int size = dist->sizes[pos];
+
+        if (++sampler->trace_pos == dist->num_points) {
+            /* Loop the trace; next pass starts one mean gap after the last entry */
+            long span = dist->offsets_us[dist->num_points - 1] - dist->offsets_us[0];
+            long gap = (dist->num_points > 1) ? span / (dist->num_points - 1) : 0;
+            sampler->trace_base_us += span + gap;
+            sampler->trace_pos = 0;
+        }
+        return size;
+    }
+    }
+    return dist->fixed_size;
+}
+
+/*
+ * Map a size to its power-of-two bucket index, or the overflow bucket
+ */
+int mt24110_size_bucket(int size) {
+    int bucket = 0;
+    while (bucket < MT24110_SIZE_BUCKET_OVERFLOW && (1 << bucket) < size) {
+        bucket++;
+    }
+    return bucket;
+}
+
+void mt24110_buckets_add(MT24110_SizeBuckets *b, int size, long latency_us) {
+    int i = mt24110_size_bucket(size);
+    b->messages[i]++;
+    b->bytes[i] += size;
+    b->latency_us[i] += latency_us;
+}
+
+void mt24110_bucket_stats_init(MT24110_SizeBucketStats *stats) {
+    for (int i = 0; i < MT24110_SIZE_BUCKETS; i++) {
+        atomic_store(&stats->messages[i], 0);
+        atomic_store(&stats->bytes[i], 0);
+        atomic_store(&stats->latency_us[i], 0);
+    }
+}
+
+/*
+ * Fold a thread's local bucket counters into the global ones
+ */
+void mt24110_bucket_stats_merge(MT24110_SizeBucketStats *stats, const MT24110_SizeBuckets *b) {
+    for (int i = 0; i < MT24110_SIZE_BUCKETS; i++) {
+        if (b->messages[i] == 0) continue;
+        atomic_fetch_add(&stats->messages[i], b->messages[i]);
+        atomic_fetch_add(&stats->bytes[i], b->bytes[i]);
+        atomic_fetch_add(&stats->latency_us[i], b->latency_us[i]);
+    }
+}
+
+/*
+ * Print per-bucket throughput and latency. Buckets with no traffic are skipped.
+ */
+void mt24110_bucket_stats_print(MT24110_SizeBucketStats *stats, double duration_sec) {
+    printf("\n=== Per Size Bucket ===\n");
+    printf("%-20s %12s %12s %14s\n", "Size range (B)", "Messages", "Gbps", "Avg lat (us)");
+
+    for (int i = 0; i < MT24110_SIZE_BUCKETS; i++) {
+        long m = atomic_load(&stats->messages[i]);
+        if (m == 0) continue;
+        long b = atomic_load(&stats->bytes[i]);
+        long l = atomic_load(&stats->latency_us[i]);
+
+        char range[32];
+        long lo = (i == 0) ? 1 : (1L << (i - 1)) + 1;
+        if (i == MT24110_SIZE_BUCKET_OVERFLOW) {
+            snprintf(range, sizeof(range), ">%ld", lo - 1);
+        } else {
+            snprintf(range, sizeof(range), "%ld-%ld", lo, 1L << i);
+        }
+        printf("%-20s %12ld %12.4f %14.2f\n", range, m,
+               (b * 8.0) / (duration_sec * 1e9), (double)l / m);
+    }
+}
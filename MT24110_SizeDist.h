@@ -0,0 +1,87 @@
+/*
+ * MT24110_SizeDist.h
+ * Message size distributions, trace replay and per-size-bucket statistics
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * Spec strings accepted by mt24110_size_dist_parse():
+ *   fixed:N                        - every message is N bytes
+ *   uniform:MIN:MAX                - uniform in [MIN, MAX]
+ *   lognormal:MEDIAN:SIGMA[:MIN:MAX] - ln(size) ~ N(ln(MEDIAN), SIGMA)
+ *   cdf:FILE                       - empirical CDF, lines "<size> <cum_prob>"
+ *   trace:FILE                     - replay, lines "<offset_us> <size>"
+ */
+
+#ifndef MT24110_SIZEDIST_H
+#define MT24110_SIZEDIST_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/*
+ * Power-of-two size buckets: bucket i holds sizes in (2^(i-1), 2^i] up to
+ * 8MB; the last bucket collects everything larger.
+ */
+#define MT24110_SIZE_BUCKETS 25
+#define MT24110_SIZE_BUCKET_OVERFLOW (MT24110_SIZE_BUCKETS - 1)
+
+typedef enum {
+    MT24110_DIST_FIXED,
+    MT24110_DIST_UNIFORM,
+    MT24110_DIST_LOGNORMAL,
+    MT24110_DIST_EMPIRICAL,
+    MT24110_DIST_TRACE
+} MT24110_DistKind;
+
+/* Parsed distribution, shared read-only by all worker threads */
+typedef struct {
+    MT24110_DistKind kind;
+    int fixed_size;
+    int min_size;
+    int max_size;
+    double mu;
+    double sigma;
+    int num_points;
+    int *sizes;           /* CDF sizes or trace sizes */
+    double *cdf;          /* cumulative probabilities (empirical) */
+    long *offsets_us;     /* send offsets (trace) */
+} MT24110_SizeDist;
+
+/* Per-thread sampling state */
+typedef struct {
+    const MT24110_SizeDist *dist;
+    uint64_t rng;
+    int trace_pos;
+    long trace_base_us;
+} MT24110_SizeSampler;
+
+/* Per-thread bucket counters (no atomics on the hot path) */
+typedef struct {
+    long messages[MT24110_SIZE_BUCKETS];
+    long bytes[MT24110_SIZE_BUCKETS];
+    long latency_us[MT24110_SIZE_BUCKETS];
+} MT24110_SizeBuckets;
+
+/* Process-wide bucket counters, threads merge into these on exit */
+typedef struct {
+    atomic_long messages[MT24110_SIZE_BUCKETS];
+    atomic_long bytes[MT24110_SIZE_BUCKETS];
+    atomic_long latency_us[MT24110_SIZE_BUCKETS];
+} MT24110_SizeBucketStats;
+
+/* Function prototypes */
+int mt24110_size_dist_parse(const char *spec, int default_size, MT24110_SizeDist *dist);
+void mt24110_size_dist_free(MT24110_SizeDist *dist);
+const char *mt24110_size_dist_name(const MT24110_SizeDist *dist);
+
+void mt24110_sampler_init(MT24110_SizeSampler *sampler, const MT24110_SizeDist *dist, uint64_t seed);
+int mt24110_sampler_next(MT24110_SizeSampler *sampler, long *send_at_us);
+
+int mt24110_size_bucket(int size);
+void mt24110_buckets_add(MT24110_SizeBuckets *b, int size, long latency_us);
+void mt24110_bucket_stats_init(MT24110_SizeBucketStats *stats);
+void mt24110_bucket_stats_merge(MT24110_SizeBucketStats *stats, const MT24110_SizeBuckets *b);
+void mt24110_bucket_stats_print(MT24110_SizeBucketStats *stats, double duration_sec);
+
+#endif /* MT24110_SIZEDIST_H */
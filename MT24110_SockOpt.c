@@ -0,0 +1,194 @@
+/*
+ * MT24110_SockOpt.c
+ * Named kernel TCP tuning profiles applied to every data socket
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_SockOpt.h"
+#include <limits.h>
+
+static const MT24110_SockOptProfile mt24110_profiles[] = {
+    /* name          sndbuf    rcvbuf    nodelay quickack cork lowat    pacing */
+    { "default",     -1,       -1,       -1,     -1,      -1,  -1,      -1 },
+    { "latency",     -1,       -1,        1,      1,       0,  16384,   -1 },
+    { "throughput",  4 << 20,  4 << 20,   1,     -1,       0,  -1,      -1 },
+    { "bulk",        8 << 20,  8 << 20,   0,     -1,       0,  1 << 20, -1 },
+};
+
+/*
+ * Look up a profile by name (NULL means "default") and apply
+ * "key=value,..." overrides on top. Returns 0 on success, -1 on error.
+ */
+int mt24110_sockopt_profile_init(const char *name, const char *overrides,
+                                 MT24110_SockOptProfile *profile) {
+    if (name == NULL) name = "default";
+
+    size_t i;
+    for (i = 0; i < sizeof(mt24110_profiles) / sizeof(mt24110_profiles[0]); i++) {
+        if (strcmp(mt24110_profiles[i].name, name) == 0) break;
+    }
+    if (i == sizeof(mt24110_profiles) / sizeof(mt24110_profiles[0])) {
+        fprintf(stderr, "Unknown socket profile: %s (expected default, latency, throughput or bulk)\n", name);
+        return -1;
+    }
+    *profile = mt24110_profiles[i];
+
+    if (overrides == NULL) return 0;
+
+    char *copy = strdup(overrides);
+    MT24110_CHECK_NULL(copy, "strdup sockopt overrides");
+
+    char *save = NULL;
+    for (char *item = strtok_r(copy, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(item, '=');
+        if (eq == NULL) goto bad_override;
+        *eq = '\0';
+
+        /* Only plain non-negative integers; -1 ("kernel default") is the profile's job */
+        char *end = NULL;
+        errno = 0;
+        long long value = strtoll(eq + 1, &end, 10);
+        if (eq[1] == '\0' || *end != '\0' || errno != 0 || value < 0) goto bad_override;
+        if (strcmp(item, "pacing_rate") != 0 && value > INT_MAX) goto bad_override;
+
+        if (strcmp(item, "sndbuf") == 0) profile->sndbuf = (int)value;
+        else if (strcmp(item, "rcvbuf") == 0) profile->rcvbuf = (int)value;
+        else if (strcmp(item, "nodelay") == 0) profile->nodelay = (int)value;
+        else if (strcmp(item, "quickack") == 0) profile->quickack = (int)value;
+        else if (strcmp(item, "cork") == 0) profile->cork = (int)value;
+        else if (strcmp(item, "notsent_lowat") == 0) profile->notsent_lowat = (int)value;
+        else if (strcmp(item, "pacing_rate") == 0) profile->pacing_rate = value;
+        else goto bad_override;
+    }
+    free(copy);
+    return 0;
+
+bad_override:
+    fprintf(stderr, "Invalid socket option override: %s\n", overrides);
+    free(copy);
+    return -1;
+}
+
+static void mt24110_set_int(int fd, int level, int opt, int value, const char *name) {
+    if (value < 0) return;
+    if (setsockopt(fd, level, opt, &value, sizeof(value)) < 0) {
+        fprintf(stderr, "Warning: setsockopt %s=%d failed: %s\n", name, value, strerror(errno));
+    }
+}
+
+/*
+ * Apply only the buffer sizes. Used on the listening socket before
+ * listen(), so the window scale negotiated at handshake can use them.
+ */
+void mt24110_sockopt_apply_buffers(int fd, const MT24110_SockOptProfile *profile) {
+    mt24110_set_int(fd, SOL_SOCKET, SO_SNDBUF, profile->sndbuf, "SO_SNDBUF");
+    mt24110_set_int(fd, SOL_SOCKET, SO_RCVBUF, profile->rcvbuf, "SO_RCVBUF");
+}
+
+/*
+ * Apply the whole profile to a connected socket. Failures are reported
+ * as warnings; the effective values are read back separately.
+ */
+void mt24110_sockopt_apply(int fd, const MT24110_SockOptProfile *profile) {
+    mt24110_sockopt_apply_buffers(fd, profile);
+    mt24110_set_int(fd, IPPROTO_TCP, TCP_NODELAY, profile->nodelay, "TCP_NODELAY");
+    mt24110_set_int(fd, IPPROTO_TCP, TCP_QUICKACK, profile->quickack, "TCP_QUICKACK");
+    mt24110_set_int(fd, IPPROTO_TCP, TCP_CORK, profile->cork, "TCP_CORK");
+    mt24110_set_int(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, profile->notsent_lowat, "TCP_NOTSENT_LOWAT");
+
+    if (profile->pacing_rate >= 0) {
+        uint64_t rate = (uint64_t)profile->pacing_rate;
+        if (setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) < 0) {
+            fprintf(stderr, "Warning: setsockopt SO_MAX_PACING_RATE=%lu failed: %s\n",
+                    (unsigned long)rate, strerror(errno));
+        }
+    }
+}
+
+static int mt24110_get_int(int fd, int level, int opt) {
+    int value = -1;
+    socklen_t len = sizeof(value);
+    if (getsockopt(fd, level, opt, &value, &len) < 0) return -1;
+    return value;
+}
+
+/*
+ * Read back what the kernel actually uses (SO_SNDBUF/SO_RCVBUF are
+ * doubled and clamped by net.core.*mem_max; TCP_QUICKACK is not sticky)
+ */
+void mt24110_sockopt_read(int fd, MT24110_SockOptProfile *effective) {
+    effective->name = "effective";
+    effective->sndbuf = mt24110_get_int(fd, SOL_SOCKET, SO_SNDBUF);
+    effective->rcvbuf = mt24110_get_int(fd, SOL_SOCKET, SO_RCVBUF);
+    effective->nodelay = mt24110_get_int(fd, IPPROTO_TCP, TCP_NODELAY);
+    effective->quickack = mt24110_get_int(fd, IPPROTO_TCP, TCP_QUICKACK);
+    effective->cork = mt24110_get_int(fd, IPPROTO_TCP, TCP_CORK);
+    effective->notsent_lowat = mt24110_get_int(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT);
+
+    uint64_t rate = 0;
+    socklen_t len = sizeof(rate);
+    if (getsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, &len) < 0) {
+        effective->pacing_rate = -1;
+    } else if (len == sizeof(uint32_t)) {
+        effective->pacing_rate = (uint32_t)rate;
+    } else {
+        effective->pacing_rate = (int64_t)rate;
+    }
+}
+
+/*
+ * Read back fd and compare it with reference (TCP_QUICKACK is skipped,
+ * it is not sticky). A socket that differs gets a warning with its own
+ * values. Returns 1 if it differs, 0 otherwise.
+ */
+int mt24110_sockopt_compare(int fd, const MT24110_SockOptProfile *reference) {
+    MT24110_SockOptProfile current;
+    mt24110_sockopt_read(fd, &current);
+
+    if (current.sndbuf == reference->sndbuf && current.rcvbuf == reference->rcvbuf &&
+        current.nodelay == reference->nodelay && current.cork == reference->cork &&
+        current.notsent_lowat == reference->notsent_lowat &&
+        current.pacing_rate == reference->pacing_rate) {
+        return 0;
+    }
+
+    fprintf(stderr, "Warning: socket fd %d differs: SO_SNDBUF=%d SO_RCVBUF=%d TCP_NODELAY=%d "
+            "TCP_CORK=%d TCP_NOTSENT_LOWAT=%d SO_MAX_PACING_RATE=%lld\n",
+            fd, current.sndbuf, current.rcvbuf, current.nodelay, current.cork,
+            current.notsent_lowat, (long long)current.pacing_rate);
+    return 1;
+}
+
+/*
+ * Read back every socket: the first fills effective, the rest are
+ * compared with it. Returns how many differ from the first.
+ */
+int mt24110_sockopt_read_all(const int *fds, int count, MT24110_SockOptProfile *effective) {
+    int differing = 0;
+
+    mt24110_sockopt_read(fds[0], effective);
+    for (int i = 1; i < count; i++) {
+        differing += mt24110_sockopt_compare(fds[i], effective);
+    }
+    return differing;
+}
+
+/*
+ * Print the selected profile name, the effective values and how many of
+ * the sockets did not end up with them
+ */
+void mt24110_sockopt_print(const MT24110_SockOptProfile *profile, const MT24110_SockOptProfile *effective,
+                           int sockets, int differing) {
+    printf("Socket profile: %s\n", profile->name);
+    printf("  SO_SNDBUF=%d SO_RCVBUF=%d TCP_NODELAY=%d TCP_QUICKACK=%d TCP_CORK=%d\n",
+           effective->sndbuf, effective->rcvbuf, effective->nodelay,
+           effective->quickack, effective->cork);
+    printf("  TCP_NOTSENT_LOWAT=%d SO_MAX_PACING_RATE=%lld\n",
+           effective->notsent_lowat, (long long)effective->pacing_rate);
+    if (differing > 0) {
+        printf("  %d of %d sockets differ from these values\n", differing, sockets);
+    }
+}
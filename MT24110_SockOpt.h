@@ -0,0 +1,46 @@
+/*
+ * MT24110_SockOpt.h
+ * Named kernel TCP tuning profiles applied to every data socket
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * Profiles:
+ *   default    - leave kernel defaults (clients still disable Nagle)
+ *   latency    - TCP_NODELAY, TCP_QUICKACK, small TCP_NOTSENT_LOWAT
+ *   throughput - 4MB socket buffers, TCP_NODELAY
+ *   bulk       - 8MB socket buffers, Nagle on, large TCP_NOTSENT_LOWAT
+ * Individual values can be overridden with "key=value,..." where key is
+ * sndbuf, rcvbuf, nodelay, quickack, cork, notsent_lowat or pacing_rate;
+ * values must be non-negative integers.
+ */
+
+#ifndef MT24110_SOCKOPT_H
+#define MT24110_SOCKOPT_H
+
+#include <stdint.h>
+
+/* A value of -1 means "leave the kernel default" */
+typedef struct {
+    const char *name;
+    int sndbuf;
+    int rcvbuf;
+    int nodelay;
+    int quickack;
+    int cork;
+    int notsent_lowat;
+    int64_t pacing_rate;    /* bytes per second */
+} MT24110_SockOptProfile;
+
+/* Function prototypes */
+int mt24110_sockopt_profile_init(const char *name, const char *overrides,
+                                 MT24110_SockOptProfile *profile);
+void mt24110_sockopt_apply_buffers(int fd, const MT24110_SockOptProfile *profile);
+void mt24110_sockopt_apply(int fd, const MT24110_SockOptProfile *profile);
+void mt24110_sockopt_read(int fd, MT24110_SockOptProfile *effective);
+int mt24110_sockopt_compare(int fd, const MT24110_SockOptProfile *reference);
+int mt24110_sockopt_read_all(const int *fds, int count, MT24110_SockOptProfile *effective);
+void mt24110_sockopt_print(const MT24110_SockOptProfile *profile, const MT24110_SockOptProfile *effective,
+                           int sockets, int differing);
+
+#endif /* MT24110_SOCKOPT_H */
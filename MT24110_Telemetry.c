@@ -0,0 +1,275 @@
+/*
+ * MT24110_Telemetry.c
+ * Periodic TCP_INFO / SIOCOUTQ / SIOCINQ sampling of registered sockets
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_Telemetry.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+
+#define MT24110_TELEMETRY_INITIAL_SLOTS 64
+#define MT24110_TELEMETRY_INITIAL_SAMPLES 256
+
+/*
+ * Kernel struct tcp_info. glibc's copy stops at tcpi_total_retrans, the
+ * kernel ABI appends fields; the ones used here are mirrored after it.
+ */
+typedef struct {
+    struct tcp_info base;
+    uint64_t tcpi_pacing_rate;
+    uint64_t tcpi_max_pacing_rate;
+    uint64_t tcpi_bytes_acked;
+    uint64_t tcpi_bytes_received;
+    uint32_t tcpi_segs_out;
+    uint32_t tcpi_segs_in;
+    uint32_t tcpi_notsent_bytes;
+    uint32_t tcpi_min_rtt;
+    uint32_t tcpi_data_segs_in;
+    uint32_t tcpi_data_segs_out;
+    uint64_t tcpi_delivery_rate;
+    uint64_t tcpi_busy_time;
+    uint64_t tcpi_rwnd_limited;
+    uint64_t tcpi_sndbuf_limited;
+} MT24110_TcpInfo;
+
+/* Per-socket cumulative counters from the previous sample */
+typedef struct {
+    int fd;
+    int have_prev;
+    uint32_t prev_retrans;
+    uint64_t prev_busy;
+    uint64_t prev_rwnd_limited;
+    uint64_t prev_sndbuf_limited;
+} MT24110_TelemetrySlot;
+
+static pthread_mutex_t telemetry_lock = PTHREAD_MUTEX_INITIALIZER;
+static MT24110_TelemetrySlot *slots;
+static int num_slots;
+static int slot_capacity;
+
+static MT24110_TelemetrySample *samples;
+static int num_samples;
+static int sample_capacity;
+
+static pthread_t sampler_tid;
+static atomic_int sampler_running;
+static int sampler_interval_ms;
+static struct timespec sampler_start;
+
+/*
+ * Start watching fd. Safe to call before or after the sampler starts.
+ */
+void mt24110_telemetry_register(int fd) {
+    pthread_mutex_lock(&telemetry_lock);
+    if (num_slots == slot_capacity) {
+        slot_capacity = slot_capacity ? slot_capacity * 2 : MT24110_TELEMETRY_INITIAL_SLOTS;
+        slots = realloc(slots, slot_capacity * sizeof(MT24110_TelemetrySlot));
+        MT24110_CHECK_NULL(slots, "realloc telemetry slots");
+    }
+    memset(&slots[num_slots], 0, sizeof(MT24110_TelemetrySlot));
+    slots[num_slots].fd = fd;
+    num_slots++;
+    pthread_mutex_unlock(&telemetry_lock);
+}
+
+/*
+ * Stop watching fd. Must be called before fd is closed, so the
+ * sampler never reads a recycled descriptor.
+ */
+void mt24110_telemetry_unregister(int fd) {
+    pthread_mutex_lock(&telemetry_lock);
+    for (int i = 0; i < num_slots; i++) {
+        if (slots[i].fd == fd) {
+            slots[i] = slots[--num_slots];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&telemetry_lock);
+}
+
+static double mt24110_elapsed_sec(const struct timespec *from) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - from->tv_sec) + (now.tv_nsec - from->tv_nsec) / 1e9;
+}
+
+/* Read all registered sockets and append one aggregated row */
+static void mt24110_take_sample(double interval_sec) {
+    MT24110_TelemetrySample row;
+    memset(&row, 0, sizeof(row));
+    double busy_us = 0, rwnd_us = 0, sndbuf_us = 0;
+    int extended = 0;
+
+    pthread_mutex_lock(&telemetry_lock);
+    for (int i = 0; i < num_slots; i++) {
+        MT24110_TelemetrySlot *slot = &slots[i];
+        MT24110_TcpInfo info;
+        socklen_t len = sizeof(info);
+        memset(&info, 0, sizeof(info));
+
+        if (getsockopt(slot->fd, IPPROTO_TCP, TCP_INFO, &info, &len) < 0) continue;
+        int has_ext = len >= offsetof(MT24110_TcpInfo, tcpi_sndbuf_limited) + sizeof(uint64_t);
+
+        int outq = 0, inq = 0;
+        ioctl(slot->fd, SIOCOUTQ, &outq);
+        ioctl(slot->fd, SIOCINQ, &inq);
+
+        row.connections++;
+        row.avg_rtt_us += info.base.tcpi_rtt;
+        row.avg_rttvar_us += info.base.tcpi_rttvar;
+        row.avg_cwnd += info.base.tcpi_snd_cwnd;
+        row.outq_bytes += outq;
+        row.inq_bytes += inq;
+
+        if (has_ext) {
+            extended = 1;
+            row.delivery_gbps += info.tcpi_delivery_rate * 8.0 / 1e9;
+        }
+        if (slot->have_prev) {
+            row.retrans += info.base.tcpi_total_retrans - slot->prev_retrans;
+            if (has_ext) {
+                busy_us += info.tcpi_busy_time - slot->prev_busy;
+                rwnd_us += info.tcpi_rwnd_limited - slot->prev_rwnd_limited;
+                sndbuf_us += info.tcpi_sndbuf_limited - slot->prev_sndbuf_limited;
+            }
+        }
+
+        slot->have_prev = 1;
+        slot->prev_retrans = info.base.tcpi_total_retrans;
+        slot->prev_busy = info.tcpi_busy_time;
+        slot->prev_rwnd_limited = info.tcpi_rwnd_limited;
+        slot->prev_sndbuf_limited = info.tcpi_sndbuf_limited;
+    }
+    pthread_mutex_unlock(&telemetry_lock);
+
+    if (row.connections > 0) {
+        double window_us = interval_sec * 1e6 * row.connections;
+        row.avg_rtt_us /= row.connections;
+        row.avg_rttvar_us /= row.connections;
+        row.avg_cwnd /= row.connections;
+        if (extended && window_us > 0) {
+            row.busy_pct = 100.0 * busy_us / window_us;
+            row.rwnd_limited_pct = 100.0 * rwnd_us / window_us;
+            row.sndbuf_limited_pct = 100.0 * sndbuf_us / window_us;
+        }
+    }
+    row.t_sec = mt24110_elapsed_sec(&sampler_start);
+
+    /* Samples are only read after the sampler is joined, no lock needed */
+    if (num_samples == sample_capacity) {
+        sample_capacity = sample_capacity ? sample_capacity * 2 : MT24110_TELEMETRY_INITIAL_SAMPLES;
+        samples = realloc(samples, sample_capacity * sizeof(MT24110_TelemetrySample));
+        MT24110_CHECK_NULL(samples, "realloc telemetry samples");
+    }
+    samples[num_samples++] = row;
+}
+
+static void *mt24110_sampler_main(void *arg) {
+    (void)arg;
+    struct timespec next = sampler_start;
+    double last = 0;
+
+    while (atomic_load(&sampler_running)) {
+        /* Absolute deadlines so sampling cost does not drift the interval */
+        next.tv_nsec += (long)sampler_interval_ms * 1000000L;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        if (!atomic_load(&sampler_running)) break;
+
+        double now = mt24110_elapsed_sec(&sampler_start);
+        mt24110_take_sample(now - last);
+        last = now;
+    }
+    return NULL;
+}
+
+/*
+ * Start the sampler thread. interval_ms <= 0 leaves telemetry disabled.
+ */
+void mt24110_telemetry_start(int interval_ms) {
+    if (interval_ms <= 0) return;
+
+    sampler_interval_ms = interval_ms;
+    clock_gettime(CLOCK_MONOTONIC, &sampler_start);
+    atomic_store(&sampler_running, 1);
+    if (pthread_create(&sampler_tid, NULL, mt24110_sampler_main, NULL) != 0) {
+        perror("pthread_create sampler failed");
+        atomic_store(&sampler_running, 0);
+    }
+}
+
+/*
+ * Stop and join the sampler (at most one interval of delay)
+ */
+void mt24110_telemetry_stop(void) {
+    if (!atomic_exchange(&sampler_running, 0)) return;
+    pthread_join(sampler_tid, NULL);
+}
+
+/*
+ * Print means over all intervals that had at least one connection
+ */
+void mt24110_telemetry_print(void) {
+    if (num_samples == 0) return;
+
+    double rtt = 0, rttvar = 0, cwnd = 0, gbps = 0, busy = 0, rwnd = 0, sndbuf = 0;
+    double outq = 0, inq = 0;
+    long retrans = 0;
+    int n = 0;
+
+    for (int i = 0; i < num_samples; i++) {
+        MT24110_TelemetrySample *s = &samples[i];
+        if (s->connections == 0) continue;
+        rtt += s->avg_rtt_us;
+        rttvar += s->avg_rttvar_us;
+        cwnd += s->avg_cwnd;
+        gbps += s->delivery_gbps;
+        busy += s->busy_pct;
+        rwnd += s->rwnd_limited_pct;
+        sndbuf += s->sndbuf_limited_pct;
+        outq += s->outq_bytes;
+        inq += s->inq_bytes;
+        retrans += s->retrans;
+        n++;
+    }
+    if (n == 0) return;
+
+    printf("\n=== TCP Telemetry (%d intervals of %d ms) ===\n", n, sampler_interval_ms);
+    printf("RTT: %.1f us (var %.1f us), cwnd: %.1f segments\n", rtt / n, rttvar / n, cwnd / n);
+    printf("Retransmits: %ld, delivery rate: %.4f Gbps\n", retrans, gbps / n);
+    printf("Busy: %.1f%%, rwnd-limited: %.1f%%, sndbuf-limited: %.1f%%\n",
+           busy / n, rwnd / n, sndbuf / n);
+    printf("Avg queued: outq %.0f bytes, inq %.0f bytes\n", outq / n, inq / n);
+}
+
+/*
+ * Write every interval row as CSV. Returns 0 on success.
+ */
+int mt24110_telemetry_write_csv(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    fprintf(fp, "t_sec,connections,rtt_us,rttvar_us,cwnd,retrans,delivery_gbps,"
+                "busy_pct,rwnd_limited_pct,sndbuf_limited_pct,outq_bytes,inq_bytes\n");
+    for (int i = 0; i < num_samples; i++) {
+        MT24110_TelemetrySample *s = &samples[i];
+        fprintf(fp, "%.3f,%d,%.1f,%.1f,%.1f,%ld,%.4f,%.2f,%.2f,%.2f,%ld,%ld\n",
+                s->t_sec, s->connections, s->avg_rtt_us, s->avg_rttvar_us, s->avg_cwnd,
+                s->retrans, s->delivery_gbps, s->busy_pct, s->rwnd_limited_pct,
+                s->sndbuf_limited_pct, s->outq_bytes, s->inq_bytes);
+    }
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * MT24110_Telemetry.h
+ * Periodic TCP_INFO / SIOCOUTQ / SIOCINQ sampling of registered sockets
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * One sampler thread per process wakes every interval, reads every
+ * registered socket and stores one aggregated row per interval. Worker
+ * threads never touch the sampler state except to register/unregister.
+ */
+
+#ifndef MT24110_TELEMETRY_H
+#define MT24110_TELEMETRY_H
+
+/* One aggregated interval across all registered connections */
+typedef struct {
+    double t_sec;                /* end of interval, since start */
+    int connections;
+    double avg_rtt_us;
+    double avg_rttvar_us;
+    double avg_cwnd;             /* segments */
+    long retrans;                /* retransmitted segments in interval */
+    double delivery_gbps;        /* sum of kernel delivery rate estimates */
+    double busy_pct;             /* time busy sending, % of interval */
+    double rwnd_limited_pct;     /* ... limited by peer receive window */
+    double sndbuf_limited_pct;   /* ... limited by local send buffer */
+    long outq_bytes;             /* SIOCOUTQ: unacked + unsent */
+    long inq_bytes;              /* SIOCINQ: received, not yet read */
+} MT24110_TelemetrySample;
+
+/* Function prototypes */
+void mt24110_telemetry_start(int interval_ms);
+void mt24110_telemetry_stop(void);
+void mt24110_telemetry_register(int fd);
+void mt24110_telemetry_unregister(int fd);
+void mt24110_telemetry_print(void);
+int mt24110_telemetry_write_csv(const char *path);
+
+#endif /* MT24110_TELEMETRY_H */
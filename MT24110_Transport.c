@@ -0,0 +1,329 @@
+/*
+ * MT24110_Transport.c
+ * Per-message copy strategy selection (send / sendmsg / MSG_ZEROCOPY)
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_Transport.h"
+#include "MT24110_MsgTrace.h"
+#include <limits.h>
+#include <poll.h>
+#include <linux/errqueue.h>
+
+/*
+ * Calibration: smallest size probed, warmup and measured round trips per
+ * run, and runs per size and path (the median run is kept)
+ */
+#define MT24110_CALIB_MIN_SIZE 64
+#define MT24110_CALIB_WARMUP 20
+#define MT24110_CALIB_ROUNDS 50
+#define MT24110_CALIB_RUNS 5
+#define MT24110_CALIB_MAX_POINTS 32
+
+/* A threshold is only lowered for at least this mean saving per size */
+#define MT24110_CALIB_MIN_GAIN 0.02
+
+/* How long a zero-copy send waits for completions when optmem is exhausted */
+#define MT24110_ZC_REAP_TIMEOUT_MS 100
+
+/* How long a send on a full non-blocking socket waits before retrying */
+#define MT24110_SEND_WAIT_MS 100
+
+/*
+ * Parse --hybrid: "auto" requests calibration, "A:B" sets
+ * sendmsg_threshold=A and zerocopy_threshold=B. NULL keeps the
+ * classic always-zero-copy behaviour.
+ */
+int mt24110_copy_policy_parse(const char *spec, MT24110_CopyPolicy *policy, int *calibrate) {
+    policy->sendmsg_threshold = 0;
+    policy->zerocopy_threshold = 0;
+    *calibrate = 0;
+
+    if (spec == NULL) return 0;
+
+    if (strcmp(spec, "auto") == 0) {
+        *calibrate = 1;
+        return 0;
+    }
+    if (sscanf(spec, "%d:%d", &policy->sendmsg_threshold, &policy->zerocopy_threshold) != 2 ||
+        policy->sendmsg_threshold < 0 || policy->zerocopy_threshold < 0) {
+        fprintf(stderr, "Invalid hybrid policy: %s (expected auto or SENDMSG_MIN:ZEROCOPY_MIN)\n", spec);
+        return -1;
+    }
+    return 0;
+}
+
+MT24110_SendPath mt24110_select_path(const MT24110_CopyPolicy *policy, int size) {
+    if (size >= policy->zerocopy_threshold) return MT24110_PATH_ZEROCOPY;
+    if (size >= policy->sendmsg_threshold) return MT24110_PATH_SENDMSG;
+    return MT24110_PATH_SEND;
+}
+
+const char *mt24110_path_name(MT24110_SendPath path) {
+    switch (path) {
+    case MT24110_PATH_SEND:     return "send";
+    case MT24110_PATH_SENDMSG:  return "sendmsg";
+    case MT24110_PATH_ZEROCOPY: return "zerocopy";
+    default:                    return "unknown";
+    }
+}
+
+/*
+ * Drain MSG_ZEROCOPY completion notifications from the socket error queue.
+ * With timeout_ms == 0 only what is already queued is consumed; otherwise
+ * waits up to timeout_ms for the next notification while sends are pending.
+ * A traced socket queues its SO_TIMESTAMPING stamps here too; they are
+ * handed to MT24110_MsgTrace. Returns the number of sends acknowledged.
+ */
+int mt24110_reap_zerocopy(int fd, MT24110_PathCounters *counters, int timeout_ms) {
+    int reaped = 0;
+
+    while (counters->zc_pending > 0 || mt24110_msgtrace_stamps_pending()) {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EINTR) continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && timeout_ms > 0 && counters->zc_pending > 0) {
+                /* Error queue readiness is reported as POLLERR */
+                struct pollfd pfd = { .fd = fd, .events = 0, .revents = 0 };
+                if (poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLERR)) continue;
+            }
+            break;
+        }
+
+        /* A timestamp arrives as SCM_TIMESTAMPING followed by its IP_RECVERR */
+        struct scm_timestamping *tss = NULL;
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPING) {
+                tss = (struct scm_timestamping *)CMSG_DATA(cm);
+                continue;
+            }
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            struct sock_extended_err *serr = (struct sock_extended_err *)CMSG_DATA(cm);
+            if (serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING && tss != NULL) {
+                mt24110_msgtrace_kernel_stamp(serr, tss);
+                continue;
+            }
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+
+            /* ee_info..ee_data is an inclusive range of send sequence numbers */
+            long n = (long)(serr->ee_data - serr->ee_info) + 1;
+            counters->zc_completions += n;
+            counters->zc_pending -= n;
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                counters->zc_copied += n;
+            }
+            reaped += n;
+        }
+    }
+    return reaped;
+}
+
+/*
+ * Send len bytes via the chosen path. Zero-copy sends that hit the
+ * optmem limit (ENOBUFS) reap completions and retry.
+ * Returns bytes sent or -1 with errno set.
+ */
+int mt24110_transport_send(int fd, char *buffer, int len, MT24110_SendPath path,
+                           MT24110_PathCounters *counters) {
+    struct iovec iov[1];
+    struct msghdr msg_header;
+    int sent;
+
+    for (;;) {
+        if (path == MT24110_PATH_SEND) {
+            sent = send(fd, buffer, len, 0);
+        } else {
+            memset(&msg_header, 0, sizeof(msg_header));
+            iov[0].iov_base = buffer;
+            iov[0].iov_len = len;
+            msg_header.msg_iov = iov;
+            msg_header.msg_iovlen = 1;
+            sent = sendmsg(fd, &msg_header, (path == MT24110_PATH_ZEROCOPY) ? MSG_ZEROCOPY : 0);
+        }
+
+        if (sent >= 0) break;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            /* Socket buffer full: sleep until it drains instead of spinning */
+            struct pollfd pfd = { .fd = fd, .events = POLLOUT, .revents = 0 };
+            poll(&pfd, 1, MT24110_SEND_WAIT_MS);
+            continue;
+        }
+        if (errno == ENOBUFS && path == MT24110_PATH_ZEROCOPY && counters->zc_pending > 0) {
+            mt24110_reap_zerocopy(fd, counters, MT24110_ZC_REAP_TIMEOUT_MS);
+            continue;
+        }
+        return -1;
+    }
+
+    counters->messages[path]++;
+    counters->bytes[path] += sent;
+    if (path == MT24110_PATH_ZEROCOPY) {
+        counters->zc_pending++;
+    }
+    return sent;
+}
+
+/* Receive exactly len bytes, returns 0 on success */
+static int mt24110_recv_exact(int fd, char *buffer, int len) {
+    int received = 0;
+    while (received < len) {
+        int r = recv(fd, buffer + received, len - received, 0);
+        if (r <= 0) {
+            if (r < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        received += r;
+    }
+    return 0;
+}
+
+/* Mean round-trip time in ns for one run of one path and size, or -1 on error */
+static double mt24110_time_path(int fd, char *send_buffer, char *recv_buffer, int size,
+                                MT24110_SendPath path, MT24110_PathCounters *counters) {
+    struct timespec start, end;
+
+    for (int i = 0; i < MT24110_CALIB_WARMUP + MT24110_CALIB_ROUNDS; i++) {
+        if (i == MT24110_CALIB_WARMUP) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+        }
+        if (mt24110_transport_send(fd, send_buffer, size, path, counters) < 0) return -1;
+        if (mt24110_recv_exact(fd, recv_buffer, size) < 0) return -1;
+        mt24110_reap_zerocopy(fd, counters, 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double total_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return total_ns / MT24110_CALIB_ROUNDS;
+}
+
+static int mt24110_compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Pick the crossover from path "below" to path "above": the index k such
+ * that sizes[0..k) use below and sizes[k..n) use above, minimizing the
+ * summed cost relative to the cheaper path at each size. One noisy size
+ * can no longer end the search. k == n (never switch) is kept unless the
+ * switch saves at least MT24110_CALIB_MIN_GAIN per switched size.
+ */
+static int mt24110_pick_crossover(const double *below, const double *above, int n) {
+    double score[MT24110_CALIB_MAX_POINTS + 1];
+
+    score[n] = 0;
+    for (int i = 0; i < n; i++) {
+        score[n] += below[i] / MT24110_MIN(below[i], above[i]);
+    }
+    int best = n;
+    for (int k = n - 1; k >= 0; k--) {
+        double best_i = MT24110_MIN(below[k], above[k]);
+        score[k] = score[k + 1] - below[k] / best_i + above[k] / best_i;
+        if (score[k] < score[best]) best = k;
+    }
+    if (best < n && score[n] - score[best] < MT24110_CALIB_MIN_GAIN * (n - best)) {
+        best = n;
+    }
+    return best;
+}
+
+/*
+ * Measure the send / sendmsg / zero-copy crossover on this host by timing
+ * echo round trips over fd for power-of-two sizes up to max_size. Each
+ * size and path is timed MT24110_CALIB_RUNS times, interleaving the paths,
+ * and the median run is used. Returns 0 on success, -1 on socket error.
+ */
+int mt24110_calibrate_copy_policy(int fd, char *send_buffer, char *recv_buffer,
+                                  int max_size, MT24110_CopyPolicy *policy) {
+    int sizes[MT24110_CALIB_MAX_POINTS];
+    double cost[MT24110_PATH_COUNT][MT24110_CALIB_MAX_POINTS];
+    int n = 0;
+
+    MT24110_PathCounters counters;
+    memset(&counters, 0, sizeof(counters));
+
+    for (int size = MT24110_CALIB_MIN_SIZE; n < MT24110_CALIB_MAX_POINTS; size *= 2) {
+        sizes[n++] = MT24110_MIN(size, max_size);
+        if (size >= max_size) break;
+    }
+
+    printf("Calibrating copy policy (%d sizes, median of %d x %d round trips)\n",
+           n, MT24110_CALIB_RUNS, MT24110_CALIB_ROUNDS);
+    printf("%10s %12s %12s %12s\n", "Size (B)", "send (ns)", "sendmsg (ns)", "zerocopy (ns)");
+
+    for (int i = 0; i < n; i++) {
+        double runs[MT24110_PATH_COUNT][MT24110_CALIB_RUNS];
+        for (int r = 0; r < MT24110_CALIB_RUNS; r++) {
+            for (int p = 0; p < MT24110_PATH_COUNT; p++) {
+                runs[p][r] = mt24110_time_path(fd, send_buffer, recv_buffer, sizes[i],
+                                               (MT24110_SendPath)p, &counters);
+                if (runs[p][r] < 0) {
+                    perror("calibration round trip failed");
+                    return -1;
+                }
+            }
+        }
+        for (int p = 0; p < MT24110_PATH_COUNT; p++) {
+            qsort(runs[p], MT24110_CALIB_RUNS, sizeof(double), mt24110_compare_double);
+            cost[p][i] = runs[p][MT24110_CALIB_RUNS / 2];
+        }
+        printf("%10d %12.0f %12.0f %12.0f\n", sizes[i], cost[MT24110_PATH_SEND][i],
+               cost[MT24110_PATH_SENDMSG][i], cost[MT24110_PATH_ZEROCOPY][i]);
+    }
+    mt24110_reap_zerocopy(fd, &counters, MT24110_ZC_REAP_TIMEOUT_MS);
+
+    /* Copy path below the zero-copy threshold, then zero-copy against it */
+    int k = mt24110_pick_crossover(cost[MT24110_PATH_SEND], cost[MT24110_PATH_SENDMSG], n);
+    policy->sendmsg_threshold = (k < n) ? sizes[k] : INT_MAX;
+
+    double copy_cost[MT24110_CALIB_MAX_POINTS];
+    for (int i = 0; i < n; i++) {
+        copy_cost[i] = cost[(i < k) ? MT24110_PATH_SEND : MT24110_PATH_SENDMSG][i];
+    }
+    k = mt24110_pick_crossover(copy_cost, cost[MT24110_PATH_ZEROCOPY], n);
+    policy->zerocopy_threshold = (k < n) ? sizes[k] : INT_MAX;
+    return 0;
+}
+
+void mt24110_path_stats_init(MT24110_PathStats *stats) {
+    for (int p = 0; p < MT24110_PATH_COUNT; p++) {
+        atomic_store(&stats->messages[p], 0);
+        atomic_store(&stats->bytes[p], 0);
+    }
+    atomic_store(&stats->zc_completions, 0);
+    atomic_store(&stats->zc_copied, 0);
+}
+
+void mt24110_path_stats_merge(MT24110_PathStats *stats, const MT24110_PathCounters *c) {
+    for (int p = 0; p < MT24110_PATH_COUNT; p++) {
+        atomic_fetch_add(&stats->messages[p], c->messages[p]);
+        atomic_fetch_add(&stats->bytes[p], c->bytes[p]);
+    }
+    atomic_fetch_add(&stats->zc_completions, c->zc_completions);
+    atomic_fetch_add(&stats->zc_copied, c->zc_copied);
+}
+
+/*
+ * Print how many messages went down each path
+ */
+void mt24110_path_stats_print(MT24110_PathStats *stats) {
+    printf("\n=== Copy Path Counters ===\n");
+    for (int p = 0; p < MT24110_PATH_COUNT; p++) {
+        printf("%-10s messages: %ld, bytes: %ld\n", mt24110_path_name((MT24110_SendPath)p),
+               atomic_load(&stats->messages[p]), atomic_load(&stats->bytes[p]));
+    }
+    printf("Zero-copy completions: %ld (kernel copied: %ld)\n",
+           atomic_load(&stats->zc_completions), atomic_load(&stats->zc_copied));
+}
@@ -0,0 +1,64 @@
+/*
+ * MT24110_Transport.h
+ * Per-message copy strategy selection (send / sendmsg / MSG_ZEROCOPY)
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * MSG_ZEROCOPY only pays off once the message is large enough to amortize
+ * page pinning and the completion notification. The hybrid policy picks a
+ * path per message by size:
+ *   size <  sendmsg_threshold            -> send()
+ *   size <  zerocopy_threshold           -> sendmsg()
+ *   size >= zerocopy_threshold           -> sendmsg(MSG_ZEROCOPY)
+ */
+
+#ifndef MT24110_TRANSPORT_H
+#define MT24110_TRANSPORT_H
+
+#include <stdatomic.h>
+
+typedef enum {
+    MT24110_PATH_SEND,
+    MT24110_PATH_SENDMSG,
+    MT24110_PATH_ZEROCOPY,
+    MT24110_PATH_COUNT
+} MT24110_SendPath;
+
+typedef struct {
+    int sendmsg_threshold;
+    int zerocopy_threshold;
+} MT24110_CopyPolicy;
+
+/* Per-thread path counters */
+typedef struct {
+    long messages[MT24110_PATH_COUNT];
+    long bytes[MT24110_PATH_COUNT];
+    long zc_completions;     /* zero-copy sends acknowledged by the kernel */
+    long zc_copied;          /* ... of which the kernel fell back to copying */
+    long zc_pending;         /* zero-copy sends not yet acknowledged */
+} MT24110_PathCounters;
+
+/* Process-wide path counters, threads merge into these on exit */
+typedef struct {
+    atomic_long messages[MT24110_PATH_COUNT];
+    atomic_long bytes[MT24110_PATH_COUNT];
+    atomic_long zc_completions;
+    atomic_long zc_copied;
+} MT24110_PathStats;
+
+/* Function prototypes */
+int mt24110_copy_policy_parse(const char *spec, MT24110_CopyPolicy *policy, int *calibrate);
+MT24110_SendPath mt24110_select_path(const MT24110_CopyPolicy *policy, int size);
+const char *mt24110_path_name(MT24110_SendPath path);
+int mt24110_transport_send(int fd, char *buffer, int len, MT24110_SendPath path,
+                           MT24110_PathCounters *counters);
+int mt24110_reap_zerocopy(int fd, MT24110_PathCounters *counters, int timeout_ms);
+int mt24110_calibrate_copy_policy(int fd, char *send_buffer, char *recv_buffer,
+                                  int max_size, MT24110_CopyPolicy *policy);
+
+void mt24110_path_stats_init(MT24110_PathStats *stats);
+void mt24110_path_stats_merge(MT24110_PathStats *stats, const MT24110_PathCounters *c);
+void mt24110_path_stats_print(MT24110_PathStats *stats);
+
+#endif /* MT24110_TRANSPORT_H */
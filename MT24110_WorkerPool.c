@@ -0,0 +1,239 @@
+/*
+ * MT24110_WorkerPool.c
+ * Pluggable per-message handlers and a work-stealing worker pool
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ */
+
+#include "MT24110_Common.h"
+#include "MT24110_WorkerPool.h"
+#include "MT24110_Ring.h"
+#include <sched.h>
+#include <semaphore.h>
+
+#define MT24110_QUEUE_CAPACITY 1024   /* per worker */
+
+/*
+ * Per-worker job queue. Any worker may steal from it, so it needs many
+ * consumers; the ring is non-blocking because idle workers sleep on
+ * their semaphore, which a steal cannot target.
+ */
+MT24110_MPMC_RING_DEFINE(MT24110_JobQueue, mt24110_job_queue, MT24110_Job *)
+
+typedef struct {
+    MT24110_JobQueue queue;
+    sem_t wake;
+    pthread_t tid;
+    int id;
+    MT24110_WorkerPool *pool;
+    atomic_long jobs_run;
+    atomic_long jobs_stolen;
+    atomic_long wait_ns;
+} MT24110_Worker;
+
+struct MT24110_WorkerPool {
+    int num_workers;
+    MT24110_Worker *workers;
+    atomic_uint next_worker;
+    atomic_int stopping;
+};
+
+/* ---------------- Handlers ---------------- */
+
+static int mt24110_handle_echo(char *buffer, int len, uint32_t *checksum) {
+    (void)buffer;
+    (void)checksum;
+    return len;
+}
+
+/* FNV-1a over the payload, added to *checksum; echo unchanged */
+static int mt24110_handle_checksum(char *buffer, int len, uint32_t *checksum) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        h ^= (unsigned char)buffer[i];
+        h *= 16777619u;
+    }
+    *checksum += h;
+    return len;
+}
+
+/* Flip ASCII case of every byte in place, echo the result */
+static int mt24110_handle_transform(char *buffer, int len, uint32_t *checksum) {
+    (void)checksum;
+    for (int i = 0; i < len; i++) {
+        buffer[i] ^= 0x20;
+    }
+    return len;
+}
+
+static const MT24110_Handler mt24110_handlers[] = {
+    { "echo",      mt24110_handle_echo },
+    { "checksum",  mt24110_handle_checksum },
+    { "transform", mt24110_handle_transform },
+};
+
+/*
+ * Find a handler by name, NULL if unknown
+ */
+const MT24110_Handler *mt24110_handler_lookup(const char *name) {
+    for (size_t i = 0; i < sizeof(mt24110_handlers) / sizeof(mt24110_handlers[0]); i++) {
+        if (strcmp(mt24110_handlers[i].name, name) == 0) {
+            return &mt24110_handlers[i];
+        }
+    }
+    return NULL;
+}
+
+/* ---------------- Workers ---------------- */
+
+static void mt24110_execute_job(MT24110_Worker *self, MT24110_Job *job) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long waited = (now.tv_sec - job->submitted.tv_sec) * 1000000000L +
+                  (now.tv_nsec - job->submitted.tv_nsec);
+    atomic_fetch_add_explicit(&self->wait_ns, waited, memory_order_relaxed);
+
+    int notify_fd = job->notify_fd;
+    job->result_len = job->fn(job->buffer, job->len, &job->checksum);
+    atomic_fetch_add_explicit(&self->jobs_run, 1, memory_order_relaxed);
+    atomic_store_explicit(&job->done, 1, memory_order_release);
+
+    /* Last touch of the job's owner: it counts these before closing the fd */
+    uint64_t one = 1;
+    ssize_t w = write(notify_fd, &one, sizeof(one));
+    (void)w;
+}
+
+static void *mt24110_worker_main(void *arg) {
+    MT24110_Worker *self = (MT24110_Worker *)arg;
+    MT24110_WorkerPool *pool = self->pool;
+    int n = pool->num_workers;
+
+    for (;;) {
+        MT24110_Job *job = NULL;
+        mt24110_job_queue_pop(&self->queue, &job);
+
+        /* Own queue empty: try to steal from the others */
+        for (int k = 1; job == NULL && k < n; k++) {
+            if (mt24110_job_queue_pop(&pool->workers[(self->id + k) % n].queue, &job)) {
+                atomic_fetch_add_explicit(&self->jobs_stolen, 1, memory_order_relaxed);
+            }
+        }
+
+        if (job != NULL) {
+            mt24110_execute_job(self, job);
+            continue;
+        }
+        if (atomic_load(&pool->stopping)) break;
+
+        /* Spurious wakeups (job stolen by a peer) just loop around */
+        while (sem_wait(&self->wake) < 0 && errno == EINTR) {
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Create a pool with num_workers threads
+ */
+MT24110_WorkerPool *mt24110_pool_create(int num_workers) {
+    MT24110_WorkerPool *pool = malloc(sizeof(MT24110_WorkerPool));
+    MT24110_CHECK_NULL(pool, "malloc worker pool");
+
+    pool->num_workers = num_workers;
+    pool->workers = aligned_alloc(MT24110_CACHE_LINE, num_workers * sizeof(MT24110_Worker));
+    MT24110_CHECK_NULL(pool->workers, "malloc workers");
+    atomic_store(&pool->next_worker, 0);
+    atomic_store(&pool->stopping, 0);
+
+    for (int i = 0; i < num_workers; i++) {
+        MT24110_Worker *w = &pool->workers[i];
+        if (mt24110_job_queue_init(&w->queue, MT24110_QUEUE_CAPACITY, MT24110_RING_NONBLOCKING) < 0) {
+            perror("malloc job queue");
+            exit(EXIT_FAILURE);
+        }
+        sem_init(&w->wake, 0, 0);
+        w->id = i;
+        w->pool = pool;
+        atomic_store(&w->jobs_run, 0);
+        atomic_store(&w->jobs_stolen, 0);
+        atomic_store(&w->wait_ns, 0);
+    }
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&pool->workers[i].tid, NULL, mt24110_worker_main, &pool->workers[i]) != 0) {
+            perror("pthread_create worker failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+/*
+ * Stop workers once their queues are drained, join and free the pool
+ */
+void mt24110_pool_destroy(MT24110_WorkerPool *pool) {
+    if (pool == NULL) return;
+
+    atomic_store(&pool->stopping, 1);
+    for (int i = 0; i < pool->num_workers; i++) {
+        sem_post(&pool->workers[i].wake);
+    }
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->workers[i].tid, NULL);
+        sem_destroy(&pool->workers[i].wake);
+        mt24110_job_queue_destroy(&pool->workers[i].queue);
+    }
+    free(pool->workers);
+    free(pool);
+}
+
+void mt24110_job_init(MT24110_Job *job, MT24110_HandlerFn fn, int notify_fd) {
+    memset(job, 0, sizeof(*job));
+    job->fn = fn;
+    job->notify_fd = notify_fd;
+    atomic_store(&job->done, 1);
+}
+
+/*
+ * Hand the job's handler over buffer to the pool and return at once.
+ * The job must be done (or fresh) and buffer must stay untouched until
+ * mt24110_job_done() reports the result.
+ */
+void mt24110_pool_submit(MT24110_WorkerPool *pool, MT24110_Job *job, char *buffer, int len) {
+    job->buffer = buffer;
+    job->len = len;
+    atomic_store_explicit(&job->done, 0, memory_order_relaxed);
+
+    clock_gettime(CLOCK_MONOTONIC, &job->submitted);
+    unsigned idx = atomic_fetch_add_explicit(&pool->next_worker, 1, memory_order_relaxed) % pool->num_workers;
+    MT24110_Worker *target = &pool->workers[idx];
+
+    while (!mt24110_job_queue_push(&target->queue, job)) {
+        sched_yield();
+    }
+    sem_post(&target->wake);
+}
+
+/*
+ * Print per-worker job counts, steals and average queueing delay
+ */
+void mt24110_pool_print_stats(MT24110_WorkerPool *pool) {
+    if (pool == NULL) return;
+
+    printf("\n=== Worker Pool ===\n");
+    long total_run = 0, total_stolen = 0, total_wait = 0;
+    for (int i = 0; i < pool->num_workers; i++) {
+        MT24110_Worker *w = &pool->workers[i];
+        long run = atomic_load(&w->jobs_run);
+        long stolen = atomic_load(&w->jobs_stolen);
+        long wait = atomic_load(&w->wait_ns);
+        printf("Worker %d: jobs %ld, stolen %ld, avg queue wait %.2f us\n",
+               i, run, stolen, run > 0 ? wait / 1000.0 / run : 0.0);
+        total_run += run;
+        total_stolen += stolen;
+        total_wait += wait;
+    }
+    printf("Total: jobs %ld, stolen %ld, avg queue wait %.2f us\n",
+           total_run, total_stolen, total_run > 0 ? total_wait / 1000.0 / total_run : 0.0);
+}
@@ -0,0 +1,58 @@
+/*
+ * MT24110_WorkerPool.h
+ * Pluggable per-message handlers and a work-stealing worker pool
+ * Myself: Akash Singh (MT24110)
+ * Location: Bulandshahr, UP, INDIA
+ * Education: MTech at IIITD, CSE
+ *
+ * Each worker owns a bounded lock-free MPMC queue. I/O threads push jobs
+ * round-robin; a worker with an empty queue steals from the others before
+ * sleeping on its semaphore. Submission does not wait: a finished job sets
+ * its done flag and then writes 1 to its notify eventfd, so the I/O thread
+ * keeps receiving while jobs run and sends replies in submission order.
+ */
+
+#ifndef MT24110_WORKERPOOL_H
+#define MT24110_WORKERPOOL_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/* Handler: processes buffer in place, returns the number of bytes to echo */
+typedef int (*MT24110_HandlerFn)(char *buffer, int len, uint32_t *checksum);
+
+typedef struct {
+    const char *name;
+    MT24110_HandlerFn fn;
+} MT24110_Handler;
+
+/* One unit of work, owned by the submitting connection and reused */
+typedef struct {
+    char *buffer;
+    int len;
+    int result_len;
+    uint32_t checksum;          /* accumulated over every run of this job */
+    MT24110_HandlerFn fn;
+    int notify_fd;              /* eventfd written once per completed run */
+    atomic_int done;
+    struct timespec submitted;
+} MT24110_Job;
+
+typedef struct MT24110_WorkerPool MT24110_WorkerPool;
+
+/* Function prototypes */
+const MT24110_Handler *mt24110_handler_lookup(const char *name);
+
+MT24110_WorkerPool *mt24110_pool_create(int num_workers);
+void mt24110_pool_destroy(MT24110_WorkerPool *pool);
+void mt24110_job_init(MT24110_Job *job, MT24110_HandlerFn fn, int notify_fd);
+void mt24110_pool_submit(MT24110_WorkerPool *pool, MT24110_Job *job, char *buffer, int len);
+void mt24110_pool_print_stats(MT24110_WorkerPool *pool);
+
+/* Has the last submission of job finished? Its result is visible once true */
+static inline int mt24110_job_done(MT24110_Job *job) {
+    return atomic_load_explicit(&job->done, memory_order_acquire);
+}
+
+#endif /* MT24110_WORKERPOOL_H */
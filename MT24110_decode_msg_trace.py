@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+#
+# MT24110_decode_msg_trace.py
+# Decode --msg-trace files and break round trips down by stage
+# Myself: Akash Singh (MT24110)
+# Location: Bulandshahr, UP, INDIA
+# Education: MTech at IIITD, CSE
+#
+# Usage: python3 MT24110_decode_msg_trace.py CLIENT.trc [SERVER.trc] [--csv OUT.csv]
+#
+# Client and server records are joined per connection (client port) by
+# stream offset: a message ending at offset E was received by the server
+# with the first recv() chunk reaching E and echoed with the first send()
+# reaching E. Kernel TX stamps carry the offset of the send they belong
+# to. Stamps are CLOCK_REALTIME, so both files must come from one host.
+#
+
+import argparse
+import bisect
+import struct
+import sys
+
+MAGIC = b'MT24TRC1'
+HEADER = struct.Struct('<8sIIII')
+RECORD = struct.Struct('<QQIIHHBB2x')
+
+# Must match MT24110_TraceEvent in MT24110_MsgTrace.h
+SEND_ENTER, SEND_EXIT, TX_SCHED, TX_SOFTWARE, TX_ACK, SERVER_RECV, SERVER_SEND, RECV = range(8)
+PATH_NAMES = ['send', 'sendmsg', 'zerocopy']
+
+# (name, from, to): stage duration is stamp[to] - stamp[from]
+STAGES = [
+    ('send call', 'enter', 'exit'),
+    ('enter -> qdisc', 'enter', 'sched'),
+    ('qdisc -> driver', 'sched', 'driver'),
+    ('enter -> server recv', 'enter', 'srv_recv'),
+    ('server turnaround', 'srv_recv', 'srv_send'),
+    ('server send -> client recv', 'srv_send', 'recv'),
+    ('enter -> peer ACK', 'enter', 'ack'),
+    ('round trip', 'enter', 'recv'),
+]
+
+
+def read_trace(path):
+    """Return (role, records) with records as tuples in RECORD order"""
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        sys.exit(f'{path}: too short for a trace header')
+    magic, version, record_size, role, _pid = HEADER.unpack_from(data)
+    if magic != MAGIC or record_size != RECORD.size:
+        sys.exit(f'{path}: not a version {version} message trace')
+    body = data[HEADER.size:]
+    body = body[:len(body) - len(body) % RECORD.size]
+    return role, list(RECORD.iter_unpack(body))
+
+
+def build_messages(client_records):
+    """One dict per client message, keyed by (port, end offset)"""
+    messages = {}
+    kernel = {TX_SCHED: 'sched', TX_SOFTWARE: 'driver', TX_ACK: 'ack'}
+
+    for ts, offset, seq, size, port, thread, event, path in client_records:
+        key = (port, offset)
+        if event == SEND_ENTER:
+            messages[key] = {'port': port, 'thread': thread, 'seq': seq, 'size': size,
+                             'offset': offset, 'path': path, 'enter': ts}
+        elif key in messages:
+            msg = messages[key]
+            if event == SEND_EXIT:
+                msg['exit'] = ts
+            elif event == RECV:
+                msg['recv'] = ts
+            elif event in kernel:
+                msg[kernel[event]] = ts
+    return messages
+
+
+def join_server(messages, server_records):
+    """Attach the server recv()/send() chunk that completed each message"""
+    chunks = {}
+    for ts, offset, _seq, _size, port, _thread, event, _path in server_records:
+        if event in (SERVER_RECV, SERVER_SEND):
+            chunks.setdefault((port, event), []).append((offset, ts))
+    for lst in chunks.values():
+        lst.sort()
+    offsets = {k: [o for o, _ in v] for k, v in chunks.items()}
+
+    for msg in messages.values():
+        for event, name in ((SERVER_RECV, 'srv_recv'), (SERVER_SEND, 'srv_send')):
+            key = (msg['port'], event)
+            if key not in chunks:
+                continue
+            i = bisect.bisect_left(offsets[key], msg['offset'])
+            if i < len(chunks[key]):
+                msg[name] = chunks[key][i][1]
+
+
+def percentile(sorted_values, q):
+    return sorted_values[int(q * (len(sorted_values) - 1))]
+
+
+def print_breakdown(messages):
+    by_path = {}
+    for msg in messages.values():
+        if 'recv' in msg:
+            by_path.setdefault(msg['path'], []).append(msg)
+
+    for path, msgs in sorted(by_path.items()):
+        name = PATH_NAMES[path] if path < len(PATH_NAMES) else str(path)
+        print(f'\n=== {name}: {len(msgs)} complete messages ===')
+        print(f'{"stage":<28} {"count":>8} {"mean us":>10} {"p50 us":>10} {"p99 us":>10}')
+        for stage, start, end in STAGES:
+            values = sorted((m[end] - m[start]) / 1000.0 for m in msgs if start in m and end in m)
+            if not values:
+                print(f'{stage:<28} {0:>8} {"-":>10} {"-":>10} {"-":>10}')
+                continue
+            mean = sum(values) / len(values)
+            print(f'{stage:<28} {len(values):>8} {mean:>10.2f} '
+                  f'{percentile(values, 0.5):>10.2f} {percentile(values, 0.99):>10.2f}')
+
+
+def write_csv(messages, path):
+    columns = ['enter', 'exit', 'sched', 'driver', 'srv_recv', 'srv_send', 'recv', 'ack']
+    with open(path, 'w') as f:
+        f.write('port,thread,seq,size,path,' + ','.join(c + '_ns' for c in columns) + '\n')
+        for msg in sorted(messages.values(), key=lambda m: (m['port'], m['offset'])):
+            stamps = [str(msg[c] - msg['enter']) if c in msg else '' for c in columns]
+            path_name = PATH_NAMES[msg['path']] if msg['path'] < len(PATH_NAMES) else str(msg['path'])
+            f.write(f"{msg['port']},{msg['thread']},{msg['seq']},{msg['size']},{path_name},"
+                    + ','.join(stamps) + '\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Per-stage latency from --msg-trace files')
+    parser.add_argument('traces', nargs='+', help='client trace, optionally a server trace')
+    parser.add_argument('--csv', help='write one row per message (stamps relative to send entry, ns)')
+    args = parser.parse_args()
+
+    client, server = [], []
+    for path in args.traces:
+        role, records = read_trace(path)
+        (server if role == 1 else client).extend(records)
+    if not client:
+        sys.exit('no client trace given')
+
+    messages = build_messages(client)
+    join_server(messages, server)
+    print_breakdown(messages)
+    if args.csv:
+        write_csv(messages, args.csv)
+        print(f'\nPer-message stamps written to {args.csv}')
+
+
+if __name__ == '__main__':
+    main()
@@ -19,6 +19,12 @@ PORT=8081
 DURATION=5
 SERVER_IP="192.168.42.68"
 
+# Extra client options, e.g. CLIENT_OPTS="--size-dist=cdf:sizes.txt"
+CLIENT_OPTS="${CLIENT_OPTS:-}"
+
+# Extra server options, e.g. SERVER_OPTS="--sockopt-profile=throughput"
+SERVER_OPTS="${SERVER_OPTS:-}"
+
 # Message sizes to test (in bytes)
 MESSAGE_SIZES=(512 1024 4096 8192)
 
@@ -51,14 +57,14 @@ run_experiment() {
     echo "  Running: impl=$impl msg_size=$msg_size threads=$threads"
 
     # Start server in background
-    ./MT24110_A${impl}_Server $PORT $msg_size > /dev/null 2>&1 &
+    ./MT24110_A${impl}_Server $PORT $msg_size $SERVER_OPTS > /dev/null 2>&1 &
     SERVER_PID=$!
 
     # Wait for server to start
     sleep 2
 
     # Run client and capture output
-    CLIENT_OUTPUT=$(./MT24110_A${impl}_Client $SERVER_IP $PORT $msg_size $threads $DURATION 2>&1)
+    CLIENT_OUTPUT=$(./MT24110_A${impl}_Client $SERVER_IP $PORT $msg_size $threads $DURATION $CLIENT_OPTS 2>&1)
 
     # Stop server
     kill $SERVER_PID 2>/dev/null || true
@@ -95,7 +101,7 @@ run_profiled_experiment() {
     # Run client with perf stat
     PERF_OUTPUT="perf stat -e cycles,instructions,L1-dcache-load-misses,cache-misses,context-switches -o ${output_prefix}_perf.txt "
 
-    $PERF_OUTPUT ./MT24110_A${impl}_Client $SERVER_IP $PORT $msg_size $threads $DURATION > /dev/null 2>&1 &
+    $PERF_OUTPUT ./MT24110_A${impl}_Client $SERVER_IP $PORT $msg_size $threads $DURATION $CLIENT_OPTS > /dev/null 2>&1 &
     CLIENT_PID=$!
 
     wait $CLIENT_PID
@@ -163,6 +169,12 @@ for msg_size in "${PROFILED_SIZES[@]}"; do
     done
 done
 
+echo ""
+echo "Step 4: Measuring copy / syscall / TCP cost per message..."
+if [ -x ./MT24110_Bench_CopyCost ] || make MT24110_Bench_CopyCost > /dev/null; then
+    ./MT24110_Bench_CopyCost 50000 "${MESSAGE_SIZES[@]}" > "${RESULTS_DIR}/MT24110_copy_cost.txt"
+fi
+
 echo ""
 echo "============================================="
 echo "Experiments Complete!"
@@ -175,6 +187,7 @@ echo "  ${RESULTS_DIR}/MT24110_results_0copy.csv"
 echo ""
 echo "Perf data saved to:"
 echo "  ${RESULTS_DIR}/MT24110_perf_*.txt"
+echo "  ${RESULTS_DIR}/MT24110_copy_cost.txt"
 echo ""
 
 